@@ -1,841 +1,4311 @@
-#include <iostream>
-#include <string>
-#include <map>
-#include <vector>
-#include <fstream>
-#include <ostream>
-#include <sstream>
-#include <cassert>
-#include <ctime>
-#include <limits>  // Added for input validation
-
-using namespace std;
-
-// Utility Functions
-
-// Read lines from a file into a vector
-vector<string> ReadFile(const string& path) {
-    vector<string> lines;
-    ifstream file(path);
-    if (!file.is_open()) {
-        throw runtime_error("ERROR: Can't open the file");
-    }
-    string line;
-    while (getline(file, line)) {
-        if (!line.empty()) {
-            lines.push_back(line);
-        }
-    }
-    file.close();
-    return lines;
-}
-
-// Write lines to a file, with an option to append
-void WriteFile(const string& path, const vector<string>& lines, bool append = true) {
-    ios::openmode mode = ios::out | ios::trunc;
-    if (append) {
-        mode = ios::out | ios::app;
-    }
-    ofstream file(path, mode);
-    if (!file.is_open()) {
-        throw runtime_error("ERROR: Can't open the file");
-    }
-    for (const string& line : lines) {
-        file << line << "\n";
-    }
-    file.close();
-}
-
-// Splitting the string that has been stored in the database
-vector<string> SplitString(string line, string delimiter = ",") {
-    vector<string> strs;
-
-    int pos = 0;
-    while((pos = (int) line.find(delimiter)) != -1){
-        
-        strs.push_back(line.substr(0,pos));
-        line.erase(0, pos + delimiter.length());
-    }
-    strs.push_back(line);
-    return strs;
-}
-
-// Reading a number from the user
-int ReadInt(int low, int high) {
-    int value;
-    while (true) {
-        cout << "\nEnter a number in the range " << low << " - " << high << ": ";
-        if (cin >> value) {
-            if (value >= low && value <= high) {
-                return value;
-            } else {
-                cout << "ERROR: Number out of range. Try again." << endl;
-            }
-        } else {
-            cout << "ERROR: Invalid input. Please enter a valid number." << endl;
-            cin.clear();            // Clear the error state
-            cin.ignore(numeric_limits<streamsize>::max(), '\n');  // Ignore any remaining input up to a newline
-        }
-    }
-}
-
-// Print the choices to choose from
-int ShowMenu(vector<string> options){
-    cout<<"\nMenu:\n";
-    for(int i =0 ; i < options.size(); i++){
-        cout<<"\t"<< 1+i << ") "<< options[i] << endl;
-    }
-    return ReadInt(1,options.size());
-}
-
-// Integer Conversion
-int ToInt(string str) {
-    int id;
-    istringstream iss(str);
-    if (!(iss >> id)) {
-        cout << "ERROR: Invalid input for integer conversion.\n";
-        return -1; // Return a default value or handle the error as needed
-    }
-    return id;
-}
-
-// Double Conversion
-double ToDouble(string str) {
-    double balance;
-    istringstream iss(str);
-    if (!(iss >> balance)) {
-        cout << "ERROR: Invalid input for double conversion.\n";
-        return -1.0; // Return a default value or handle the error as needed
-    }
-    return balance;
-}
-
-bool ValidatePassword(const string& password) {
-    // Password must be at least 8 characters long
-    if (password.length() < 8) {
-        return false;
-    }
-
-    bool hasDigit = false;
-    bool hasCharacter = false;
-    bool hasSpecialCharacter = false;
-    bool hasUppercaseLetter = false;
-
-    for (char ch : password) {
-        if (isdigit(ch)) {
-            hasDigit = true;
-        } else if (isalpha(ch)) {
-            hasCharacter = true;
-            if (isupper(ch)) {
-                hasUppercaseLetter = true;
-            }
-        } else {
-            hasSpecialCharacter = true;
-        }
-    }
-
-    // Password must contain at least one digit, one character, one special character, and one uppercase letter
-    return hasDigit && hasCharacter && hasSpecialCharacter && hasUppercaseLetter;
-}
-
-
-//// Classes  ////
-
-class TransactionHistory {
-private:
-    string type;
-    string date;
-    string message;
-    double balance;
-    double amount;
-    int accID;
-
-public:
-    // Default constructor
-    TransactionHistory()
-        : type(""), date(""), message(""), amount(0.0), accID(-1), balance(0.0) {}
-
-    // Parameterized constructor
-    TransactionHistory(const string& type_, const string& message_,
-                       const double amount_, const string& date_,
-                       const int id, const double balance_)
-        : type(type_), message(message_), amount(amount_), date(date_), accID(id), balance(balance_) {}
-
-    // Constructor to create a TransactionHistory object from a formatted string
-    TransactionHistory(string line) {
-        vector<string> content = SplitString(line);
-        assert(content.size() == 6);
-        accID = ToInt(content[0]);
-        type = content[1];
-        amount = ToDouble(content[2]);
-        message = content[3];
-        balance = ToDouble(content[4]);
-        date = content[5];
-    }
-
-    // Convert a TransactionHistory object to a formatted string
-    string ToString() {
-        ostringstream oss;
-        oss << accID << "," << type << "," << amount << "," << message << "," << balance << "," << date;
-        return oss.str();
-    }
-
-    // Print transaction details
-    void Print() {
-        cout << "\n ---------------------\n\n";
-        cout << type << " $" << amount << " - Balance: $" << balance << endl << message << date;
-        cout << "\n ---------------------\n";
-    }
-
-    // Get the account ID associated with this transaction
-    const int GetAccountID() {
-        return accID;
-    }
-};
-
-class Account {
-private:
-    int accountID;
-    double balance;
-    vector<TransactionHistory> transactionHistory;
-
-public:
-    // Default constructor
-    Account() : accountID(-1), balance(0.0) {}
-
-    // Constructor to initialize an Account object from a line of text
-    Account(string line) {
-        vector<string> content = SplitString(line);
-        assert(content.size() == 2);
-        accountID = ToInt(content[0]);
-        balance = ToDouble(content[1]);
-    }
-
-    // Add a transaction to the account's transaction history
-    void AddTransaction(const TransactionHistory& transaction) {
-        transactionHistory.push_back(transaction);
-    }
-
-    // Get the transaction history as a vector of strings
-    vector<string> GetTransactionHistory() {
-        vector<string> transactionLines;
-        for (auto& transaction : transactionHistory) {
-            transactionLines.push_back(transaction.ToString());
-        }
-        return transactionLines;
-    }
-
-    // Print account information
-    void PrintInfo() {
-        cout << "\t-> Account Details <-\n";
-        cout << "-> Account ID: " << accountID << "\n";
-        cout << "-> Account Balance: $" << balance << "\n\n";
-    }
-
-    // Print transaction history
-    void PrintTransactionHistory() {
-        if (transactionHistory.empty()) {
-            cout << "\n\t->-> Transaction history is empty! <-<-\n";
-            return;
-        }
-        cout << "\n\t->-> Transaction History <-<-\n";
-
-        for (auto& transaction : transactionHistory) {
-            transaction.Print();
-        }
-    }
-
-    // Convert Account object to a string for storage
-    string ToString() const {
-        ostringstream oss;
-        oss << accountID << "," << balance;
-        return oss.str();
-    }
-
-    // Update the account balance
-    void UpdateBalance(double newBalance) {
-        balance += newBalance;
-    }
-
-    // Setter for balance
-    void SetBalance(double balance_) {
-        balance = balance_;
-    }
-
-    // Setter for account ID
-    void SetAccountID(int id_) {
-        accountID = id_;
-    }
-
-    // Getter for account ID
-    const int& GetAccountID() const {
-        return accountID;
-    }
-
-    // Getter for balance
-    double& GetBalance() {
-        return balance;
-    }
-
-};
-
-class User {
-private:
-    string firstName;
-    string lastName;
-    string email;
-    string userName;
-    string password;
-    int accID;
-
-public:
-    // Default constructor
-    User() : firstName(""), lastName(""), email(""), userName(""), password(""), accID(-1) {}
-
-    // Constructor to initialize a User object from a line of text
-    User(string line) {
-        vector<string> content = SplitString(line);
-        assert(content.size() == 6);
-        firstName = content[0];
-        lastName = content[1];
-        email = content[2];
-        userName = content[3];
-        password = content[4];
-        accID = ToInt(content[5]);
-    }
-
-    // Read user data and initialize a User object
-    void ReadData(const string& newUserName, int newAccountID) {
-        accID = newAccountID;
-        userName = newUserName;
-        // Input and validate the user's password
-        while (true) {
-            cout << "\nEnter your password \n(at least 8 characters with numbers, characters,\n special characters, and an uppercase letter): ";
-            cin >> password;
-
-            if (ValidatePassword(password)) {
-                string confirmPassword;
-                cout << "\nConfirm your password: ";
-                cin >> confirmPassword;
-
-                if (password == confirmPassword) {
-                    break;
-                } else {
-                    cout << "Passwords do not match. Please try again." << endl;
-                }
-            } else {
-                cout << "\n->-> Invalid password format. Please try again. <-<-\n" << endl;
-            }
-        }
-
-        cout << "Enter First Name: ";
-        cin >> firstName;
-        cout << "Enter Last Name: ";
-        cin >> lastName;
-        cout << "Enter Email: ";
-        cin >> email;
-
-    } 
-
-    
-    // Getters for user attributes
-    const string &GetUserName() const {
-        return userName;
-    }
-    
-    int GetAccountID(){
-        return accID;
-    }
-
-    const string &GetPassword() const {
-        return password;
-    }
-
-    // Setters for user attributes
-    void ChangeFirstName(string fname) {
-        firstName = fname;
-    }
-
-    void ChangeLastName(string lname) {
-        lastName = lname;
-    }
-
-    void ChangeEmail(string email_) {
-        email = email_;
-    }
-
-    void ChangeUserName(string user_name) {
-        userName = user_name;
-    }
-
-    void ChangePassword(string pass) {
-        password = pass;
-    }
-
-    // Convert User object to a string for storage
-    string ToString() const {
-        ostringstream oss;
-        oss << firstName << "," << lastName << "," << email << "," << userName << "," << password << "," << accID;
-        return oss.str();
-    }
-
-    // Print user information
-    void PrintInfo() const {
-        cout << "\t->-> Personal Details <-<-\n";
-        cout << "Mr/s: " << firstName << " " << lastName << endl;
-        cout << "Email: " << email << "\nUser Name: " << userName << endl;
-        cout << "Account Number: " << accID << endl;
-    }
-
-    // Get the account ID of the user
-    const int GetAccID() const {
-        return accID;
-    }
-
-};
-
-class BankSystem {
-private:
-    User currentUser;
-    Account currentAccount;
-    map<string, User> userMap; // username to user object
-    map<int, Account> accountMap; // account id to account object
-    int lastAccountID;
-
-public:
-    BankSystem() : currentUser(), currentAccount(), lastAccountID(0) {}
-
-    void UpdateDatabase() {
-        // Update user data
-        vector<string> userLines;
-        for (const auto& userPair : userMap) {
-            userLines.push_back(userPair.second.ToString());
-        }
-        WriteFile("users.txt", userLines, false);
-
-        // Update account data
-        vector<string> accountLines;
-        for (const auto& accountPair : accountMap) {
-            accountLines.push_back(accountPair.second.ToString());
-        }
-        WriteFile("accounts.txt", accountLines, false);
-
-        // Update transaction history data
-        vector<string> historyLines;
-        for (auto& accountPair : accountMap) {
-            vector<string> transactionLines = accountPair.second.GetTransactionHistory();
-            historyLines.insert(historyLines.end(), transactionLines.begin(), transactionLines.end());
-        }
-        WriteFile("history.txt", historyLines, false);
-
-        LoadDatabase(); // Reload data after updating
-    }
-
-    void LoadDatabase() {
-        userMap.clear();
-        accountMap.clear();
-
-        // Load user data
-        vector<string> userLines = ReadFile("users.txt");
-        for (const string& userLine : userLines) {
-            User user(userLine);
-            userMap[user.GetUserName()] = user;
-        }
-
-        // Load account data
-        vector<string> accountLines = ReadFile("accounts.txt");
-        for (const string& accountLine : accountLines) {
-            Account account(accountLine);
-            accountMap[account.GetAccountID()] = account;
-            lastAccountID = max(lastAccountID, account.GetAccountID());
-        }
-
-        // Load transaction history data
-        vector<string> historyLines = ReadFile("history.txt");
-        for (const string& historyLine : historyLines) {
-            TransactionHistory transaction(historyLine);
-            accountMap[transaction.GetAccountID()].AddTransaction(transaction);
-        }
-    }
-
-    void Access() {
-        LoadDatabase();
-        int choice = ShowMenu({ "Login", "Sign Up" });
-        if (choice == 1)
-            Login();
-        else
-            SignUp();
-    }
-
-    void Run() {
-        Access();
-
-        while (true) {
-            vector<string> menuOptions;
-            menuOptions.push_back("Account Information");
-            menuOptions.push_back("Personal Information");
-            menuOptions.push_back("Edit Personal Information");
-            menuOptions.push_back("Transaction History");
-            menuOptions.push_back("Transfer Money");
-            menuOptions.push_back("Deposit Money");
-            menuOptions.push_back("Withdraw Money");
-            menuOptions.push_back("Log Out");
-
-
-            int choice = ShowMenu(menuOptions);
-
-            switch (choice) {
-                case 1:
-                    currentAccount.PrintInfo();
-                    break;
-                case 2:
-                    currentUser.PrintInfo();
-                    break;
-                case 3:
-                    EditPersonalInfo();
-                    break;
-                case 4:
-                    currentAccount.PrintTransactionHistory();
-                    break;
-                case 5:
-                    TransferMoney();
-                    break;
-                case 6:
-                    DepositMoney();
-                    break;
-                case 7:
-                    WithdrawMoney();
-                    break;
-                case 8:
-                    Logout();
-                    return;
-                default:
-                    break;
-            }
-                vector<string> exitOptions;
-                exitOptions.push_back("Return to Main Menu");
-                exitOptions.push_back("Exit Program");
-
-                int exitChoice = ShowMenu(exitOptions);
-
-                if (exitChoice == 2) {
-                    exit(0);  // Exit the program
-                }
-        }
-    }
-
-    void Login() {
-        while (true) {
-            string userName, password;
-            cout << "\nEnter User Name: ";
-            cin >> userName;
-            cout << "Enter Password: ";
-            cin >> password;
-
-            if (!userMap.count(userName)) {
-                cout << "\nInvalid username or password. Try again.\n";
-                continue;
-            }
-
-            currentUser = userMap[userName];
-
-            if (currentUser.GetPassword() != password) {
-                cout << "\nInvalid username or password. Try again.\n";
-                currentUser = User(); // Reset currentUser to default state
-                currentAccount = Account(); // Reset currentAccount to default state
-                continue;
-            }
-
-            currentAccount = accountMap[currentUser.GetAccountID()];
-            cout << "\n\t->->-> Welcome Back!! <-<-<-\n\n";
-            break;
-        }
-    }
-
-    void SignUp() {
-        string userName;
-        while (true) {
-            cout << "\nEnter User Name: ";
-            cin >> userName;
-            if (userMap.count(userName)) {
-                cout << "\n-> Username already in use. Try again <-\n\n";
-                continue;
-            }
-            break;
-        }
-
-        currentUser = User();
-        currentAccount = Account();
-        lastAccountID++;
-
-        currentUser.ReadData(userName, lastAccountID);
-
-        const double initialBalanceRequirement = 100.0; // Minimum balance requirement
-        cout << "\n\tTo open an account, you need to deposit at least $" << initialBalanceRequirement << endl;
-
-        double initialDeposit;
-        while (true) {
-            cout << "\n\tEnter the initial deposit amount: $";
-            cin >> initialDeposit;
-            if (initialDeposit < initialBalanceRequirement) {
-                cout << "\n\tThe initial deposit amount is less than the required amount. Try again.\n";
-            } else {
-                break;
-            }
-        }
-
-        currentAccount.SetAccountID(lastAccountID);
-        currentAccount.SetBalance(initialDeposit);
-
-        accountMap[currentUser.GetAccountID()] = currentAccount;
-        userMap[userName] = currentUser;
-
-        UpdateDatabase();
-
-        cout << "\n\t->->-> Welcome!! <-<-<-\n\n";
-    }
-
-    char* GetTime() {
-        time_t now = time(0);
-        char* dt = ctime(&now);
-        return dt;
-    }
-
-    void EditPersonalInfo() {
-        vector<string> choices;
-        choices.push_back("First Name");
-        choices.push_back("Last Name");
-        choices.push_back("Email");
-        choices.push_back("User Name");
-        choices.push_back("Password");
-
-        int choice = ShowMenu(choices);
-
-        switch (choice) {
-            case 1:
-                ChangeFirstName();
-                break;
-            case 2:
-                ChangeLastName();
-                break;
-            case 3:
-                ChangeEmail();
-                break;
-            case 4:
-                ChangeUserName();
-                break;
-            case 5:
-                ChangePassword();
-                break;
-            default:
-                break;
-        }
-
-        cout << "\nDo any other changes? (Y/N): ";
-        char input;
-        cin >> input;
-        if (input == 'y' || input == 'Y') {
-            EditPersonalInfo();
-        }
-
-        UpdateDatabase();
-    }
-
-    void ChangeFirstName() {
-        string firstName;
-        cout << "\nEnter your new First Name: ";
-        cin >> firstName;
-        currentUser.ChangeFirstName(firstName);
-        cout << "\n\t->-> Done! <-<-\n";
-
-        userMap[currentUser.GetUserName()].ChangeFirstName(firstName);
-    }
-
-    void ChangeLastName() {
-        string lastName;
-        cout << "\nEnter your Last Name: ";
-        cin >> lastName;
-        currentUser.ChangeLastName(lastName);
-        cout << "\n\t->-> Done! <-<-\n";
-
-        userMap[currentUser.GetUserName()].ChangeLastName(lastName);
-    }
-
-    void ChangeEmail() {
-        string email;
-        cout << "\nEnter your Email: ";
-        cin >> email;
-        currentUser.ChangeEmail(email);
-        cout << "\n\t->-> Done! <-<-\n";
-
-        userMap[currentUser.GetUserName()].ChangeEmail(email);
-    }
-
-    void ChangeUserName() {
-        string newUserName;
-        while (true) {
-            cout << "\nEnter your new User Name: ";
-            cin >> newUserName;
-
-            if (userMap.count(newUserName)) {
-                cout << "\n-> Username already in use. Please choose a different username.\n\n";
-            } else if (currentUser.GetUserName() == newUserName) {
-                cout << "\n-> This is your current username. Please choose a different username.\n\n";
-            } else {
-                break;
-            }
-        }
-
-        currentUser.ChangeUserName(newUserName);
-        cout << "\n\t->-> Username updated successfully! <-<-\n";
-
-        userMap[currentUser.GetUserName()] = currentUser;
-    }
-
-    void ChangePassword() {
-        string currentPassword;
-        int remainingAttempts = 3; // Number of password change attempts allowed
-
-        while (remainingAttempts > 0) {
-            cout << "\nEnter your current password: ";
-            cin >> currentPassword;
-
-            if (currentPassword != currentUser.GetPassword()) {
-                cout << "\nIncorrect current password. ";
-                cout << "Remaining attempts: " << remainingAttempts - 1 << endl;
-                remainingAttempts--;
-                continue;
-            }
-            string newPassword;
-            
-            while (true) {
-                cout << "\nEnter your password \n(at least 8 characters with numbers, characters, \nspecial characters, and an uppercase letter): ";
-                cin >> newPassword;
-
-                if (ValidatePassword(newPassword)) {
-                    string confirmPassword;
-                    cout << "Confirm your password: ";
-                    cin >> confirmPassword;
-
-                    if (newPassword == confirmPassword) {
-                        break;
-                    } else {
-                        cout << "Passwords do not match. Please try again." << endl;
-                    }
-                } else {
-                    cout << "Invalid password format. Please try again." << endl;
-                }
-            }
-            currentUser.ChangePassword(newPassword);
-            cout << "\nPassword updated successfully.\n";
-
-            userMap[currentUser.GetUserName()] = currentUser;
-
-            return;
-        }
-
-        cout << "\nExceeded maximum password change attempts. ";
-        cout << "Please try again later.\n";
-    }
-
-    void DepositMoney() {
-        double amount;
-        while (true) {
-            cout << "\nEnter the amount to deposit: $";
-            cin >> amount;
-            if (amount > 1000000.0) {
-                cout << "\n->-> You can't deposit more than a million dollars at a time. Try again <-<-\n";
-                continue;
-            }
-            break;
-        }
-
-        currentAccount.UpdateBalance(amount);
-        string transactionDate = GetTime();
-        TransactionHistory transaction("Deposit", "", amount, transactionDate, currentUser.GetAccountID(), currentAccount.GetBalance());
-        currentAccount.AddTransaction(transaction);
-        accountMap[currentAccount.GetAccountID()] = currentAccount;
-        UpdateDatabase();
-
-        cout << "\n\t->-> $" << amount << " has been added to your account successfully! <-<-\n";
-    }
-
-    void WithdrawMoney() {
-        double amount;
-        while (true) {
-            cout << "\nEnter the amount to withdraw: $";
-            cin >> amount;
-            if (currentAccount.GetBalance() < amount) {
-                cout << "\n->-> The amount you entered is greater than your balance. Try again <-<-\n";
-                continue;
-            }
-            break;
-        }
-
-        currentAccount.UpdateBalance(-amount);
-        string transactionDate = GetTime();
-        TransactionHistory transaction("Withdraw", "", amount, transactionDate, currentUser.GetAccountID(), currentAccount.GetBalance());
-        currentAccount.AddTransaction(transaction);
-        accountMap[currentAccount.GetAccountID()] = currentAccount;
-        UpdateDatabase();
-
-        cout << "\n\t->-> $" << amount << " has been withdrawn successfully! <-<-\n";
-    }
-
-    void TransferMoney() {
-        double amount;
-        while (true) {
-            cout << "\nEnter the amount to transfer: $";
-            cin >> amount;
-            if (currentAccount.GetBalance() < amount) {
-                cout << "\n->-> The amount you entered is greater than your balance. Try again <-<-\n";
-                continue;
-            }
-            break;
-        }
-
-        string receiver;
-
-        while (true) {
-            cout << "\nTo user: ";
-            cin >> receiver;
-            if (!userMap.count(receiver)) {
-                cout << "\n->-> User does not exist. Try again\n";
-                continue;
-            }
-            break;
-        }
-
-        currentAccount.UpdateBalance(-amount);
-        string transactionDate = GetTime();
-        string transactionMessage = " to (" + receiver + ") ";
-        TransactionHistory senderTransaction("Transfer", transactionMessage, amount, transactionDate, currentUser.GetAccountID(), currentAccount.GetBalance());
-        currentAccount.AddTransaction(senderTransaction);
-        accountMap[currentAccount.GetAccountID()] = currentAccount;
-
-        int receiverAccountID = userMap[receiver].GetAccountID();
-        accountMap[receiverAccountID].UpdateBalance(amount);
-        double receiverBalance = accountMap[receiverAccountID].GetBalance();
-        string receiverTransactionMessage = " from (" + currentUser.GetUserName() + ") ";
-        TransactionHistory receiverTransaction("Receive", receiverTransactionMessage, amount, transactionDate, receiverAccountID, receiverBalance);
-        accountMap[receiverAccountID].AddTransaction(receiverTransaction);
-
-        UpdateDatabase();
-
-        cout << "\n\t->$" << amount << " has been sent to " << receiver << " successfully! <-\n";
-    }
-
-    void Logout() {
-        currentUser = User();
-        currentAccount = Account();
-        cout << "\n\t->->-> You have been successfully logged out. <-<-<-\n\n";
-    }
-
-};
-
-
-int main() {
-    BankSystem system;
-    system.Run();
-    return 0;
-}
+#include <iostream>
+#include <string>
+#include <map>
+#include <vector>
+#include <fstream>
+#include <ostream>
+#include <sstream>
+#include <cassert>
+#include <ctime>
+#include <limits>  // Added for input validation
+#include <tuple>
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cerrno>
+#include <set>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <chrono>
+#include <memory>
+#include <shared_mutex>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// Utility Functions
+
+// Read lines from a file into a vector
+vector<string> ReadFile(const string& path) {
+    vector<string> lines;
+    ifstream file(path);
+    if (!file.is_open()) {
+        throw runtime_error("ERROR: Can't open the file");
+    }
+    string line;
+    while (getline(file, line)) {
+        // Tolerate files saved with Windows line endings
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            lines.push_back(line);
+        }
+    }
+    file.close();
+    return lines;
+}
+
+// Write lines to a file, with an option to append
+void WriteFile(const string& path, const vector<string>& lines, bool append = true) {
+    ios::openmode mode = ios::out | ios::trunc;
+    if (append) {
+        mode = ios::out | ios::app;
+    }
+    ofstream file(path, mode);
+    if (!file.is_open()) {
+        throw runtime_error("ERROR: Can't open the file");
+    }
+    for (const string& line : lines) {
+        file << line << "\n";
+    }
+    file.close();
+}
+
+// Splitting the string that has been stored in the database
+vector<string> SplitString(string line, string delimiter = ",") {
+    vector<string> strs;
+
+    int pos = 0;
+    while((pos = (int) line.find(delimiter)) != -1){
+        
+        strs.push_back(line.substr(0,pos));
+        line.erase(0, pos + delimiter.length());
+    }
+    strs.push_back(line);
+    return strs;
+}
+
+// Reading a number from the user
+int ReadInt(int low, int high) {
+    int value;
+    while (true) {
+        cout << "\nEnter a number in the range " << low << " - " << high << ": ";
+        if (cin >> value) {
+            if (value >= low && value <= high) {
+                return value;
+            } else {
+                cout << "ERROR: Number out of range. Try again." << endl;
+            }
+        } else {
+            cout << "ERROR: Invalid input. Please enter a valid number." << endl;
+            cin.clear();            // Clear the error state
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');  // Ignore any remaining input up to a newline
+        }
+    }
+}
+
+// Print the choices to choose from
+int ShowMenu(vector<string> options){
+    cout<<"\nMenu:\n";
+    for(int i =0 ; i < options.size(); i++){
+        cout<<"\t"<< 1+i << ") "<< options[i] << endl;
+    }
+    return ReadInt(1,options.size());
+}
+
+// Integer Conversion
+int ToInt(string str) {
+    int id;
+    istringstream iss(str);
+    if (!(iss >> id)) {
+        cout << "ERROR: Invalid input for integer conversion.\n";
+        return -1; // Return a default value or handle the error as needed
+    }
+    return id;
+}
+
+// Double Conversion
+double ToDouble(string str) {
+    double balance;
+    istringstream iss(str);
+    if (!(iss >> balance)) {
+        cout << "ERROR: Invalid input for double conversion.\n";
+        return -1.0; // Return a default value or handle the error as needed
+    }
+    return balance;
+}
+
+bool ValidatePassword(const string& password) {
+    // Password must be at least 8 characters long
+    if (password.length() < 8) {
+        return false;
+    }
+
+    bool hasDigit = false;
+    bool hasCharacter = false;
+    bool hasSpecialCharacter = false;
+    bool hasUppercaseLetter = false;
+
+    for (char ch : password) {
+        if (isdigit(ch)) {
+            hasDigit = true;
+        } else if (isalpha(ch)) {
+            hasCharacter = true;
+            if (isupper(ch)) {
+                hasUppercaseLetter = true;
+            }
+        } else {
+            hasSpecialCharacter = true;
+        }
+    }
+
+    // Password must contain at least one digit, one character, one special character, and one uppercase letter
+    return hasDigit && hasCharacter && hasSpecialCharacter && hasUppercaseLetter;
+}
+
+
+// Convert a ctime() style date ("Mon Sep 25 18:29:31 2023") into a sortable
+// YYYYMMDDhhmmss number. Returns -1 if the date can't be read.
+long long DateKey(const string& date) {
+    static const char* months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+    char weekday[4], month[4];
+    int day, hour, minute, second, year;
+    if (sscanf(date.c_str(), "%3s %3s %d %d:%d:%d %d", weekday, month, &day, &hour, &minute, &second, &year) != 7) {
+        return -1;
+    }
+    for (int i = 0; i < 12; i++) {
+        if (strcmp(month, months[i]) == 0) {
+            return ((((year * 100LL + i + 1) * 100 + day) * 100 + hour) * 100 + minute) * 100 + second;
+        }
+    }
+    return -1;
+}
+
+// Convert a ctime() style date back into seconds since the epoch, in local
+// time. Returns -1 if the date can't be read.
+time_t ParseTime(const string& date) {
+    long long key = DateKey(date);
+    if (key < 0) {
+        return -1;
+    }
+    tm parsed = {};
+    parsed.tm_sec = key % 100;
+    parsed.tm_min = key / 100 % 100;
+    parsed.tm_hour = key / 10000 % 100;
+    parsed.tm_mday = key / 1000000 % 100;
+    parsed.tm_mon = key / 100000000 % 100 - 1;
+    parsed.tm_year = (int) (key / 10000000000LL) - 1900;
+    parsed.tm_isdst = -1;
+    return mktime(&parsed);
+}
+
+// Format a time the way ctime() does, without its trailing newline
+string FormatTime(time_t when) {
+    string formatted = ctime(&when);
+    if (!formatted.empty() && formatted.back() == '\n') {
+        formatted.pop_back();
+    }
+    return formatted;
+}
+
+// Thread-safe localtime() that doesn't re-read the timezone on every call
+tm LocalTime(time_t when) {
+    tm date;
+#ifdef _WIN32
+    localtime_s(&date, &when);
+#else
+    localtime_r(&when, &date);
+#endif
+    return date;
+}
+
+// Local midnight at the start of a "YYYY-MM-DD" day. Returns -1 if the date can't be read.
+time_t DayStart(const string& day) {
+    tm date = {};
+    if (sscanf(day.c_str(), "%d-%d-%d", &date.tm_year, &date.tm_mon, &date.tm_mday) != 3
+        || date.tm_mon < 1 || date.tm_mon > 12 || date.tm_mday < 1 || date.tm_mday > 31) {
+        return -1;
+    }
+    date.tm_year -= 1900;
+    date.tm_mon -= 1;
+    date.tm_isdst = -1;
+    return mktime(&date);
+}
+
+// Local midnight at the start of the day containing `when`
+time_t DayStart(time_t when) {
+    tm date = LocalTime(when);
+    date.tm_hour = date.tm_min = date.tm_sec = 0;
+    date.tm_isdst = -1;
+    return mktime(&date);
+}
+
+// Convert a "YYYY-MM-DD" date into the same key as DateKey(), at the start or
+// the end of that day. Returns -1 if the date can't be read.
+long long DayKey(const string& day, bool endOfDay) {
+    int year, month, dayOfMonth;
+    if (sscanf(day.c_str(), "%d-%d-%d", &year, &month, &dayOfMonth) != 3
+        || month < 1 || month > 12 || dayOfMonth < 1 || dayOfMonth > 31) {
+        return -1;
+    }
+    long long key = ((year * 100LL + month) * 100 + dayOfMonth) * 1000000LL;
+    return endOfDay ? key + 235959 : key;
+}
+
+//// Record Schemas  ////
+
+// Every record type describes its columns once through a static constexpr
+// Schema(); the text and binary serializers and parsers below are generated
+// from that description instead of being hand-written per class.
+
+// A single column of a record: its name and the member it is stored in
+template <typename Record, typename T>
+struct Field {
+    const char* name;
+    T Record::*member;
+};
+
+template <typename Record, typename T>
+constexpr Field<Record, T> MakeField(const char* name, T Record::*member) {
+    return Field<Record, T>{name, member};
+}
+
+template <typename Record, typename... T>
+constexpr tuple<Field<Record, T>...> MakeSchema(Field<Record, T>... fields) {
+    return tuple<Field<Record, T>...>(fields...);
+}
+
+// Per-type encoding of a field. Only the specialised types can appear in a
+// schema; anything else fails to compile.
+template <typename T>
+struct FieldCodec;
+
+// Fixed-width little-endian helpers for the binary format
+inline void AppendLittleEndian(string& out, uint64_t value, int bytes) {
+    char buffer[8];
+    for (int i = 0; i < bytes; i++) {
+        buffer[i] = (char) ((value >> (8 * i)) & 0xFF);
+    }
+    out.append(buffer, bytes);
+}
+
+inline bool ReadLittleEndian(const char*& pos, const char* end, uint64_t& value, int bytes) {
+    if (end - pos < bytes) {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= (uint64_t) (unsigned char) pos[i] << (8 * i);
+    }
+    pos += bytes;
+    return true;
+}
+
+// Integers are written in decimal as text and as sizeof(T) little-endian bytes in binary
+template <typename T>
+struct IntegerCodec {
+    static void WriteText(string& out, T value) {
+        char buffer[24];
+        to_chars_result result = to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, result.ptr);
+    }
+
+    static bool ReadText(const char*& pos, const char* end, T& value) {
+        from_chars_result result = from_chars(pos, end, value);
+        if (result.ec != errc()) {
+            return false;
+        }
+        pos = result.ptr;
+        return true;
+    }
+
+    static void WriteBinary(string& out, T value) {
+        AppendLittleEndian(out, (uint64_t) value, sizeof(T));
+    }
+
+    static bool ReadBinary(const char*& pos, const char* end, T& value) {
+        uint64_t raw;
+        if (!ReadLittleEndian(pos, end, raw, sizeof(T))) {
+            return false;
+        }
+        value = (T) raw;
+        return true;
+    }
+};
+
+template <>
+struct FieldCodec<int> : IntegerCodec<int> {};
+
+template <>
+struct FieldCodec<long long> : IntegerCodec<long long> {};
+
+template <>
+struct FieldCodec<double> {
+    // Shortest representation that reads back to the same double
+    static void WriteText(string& out, double value) {
+        char buffer[32];
+        to_chars_result result = to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, result.ptr);
+    }
+
+    static bool ReadText(const char*& pos, const char* end, double& value) {
+        from_chars_result result = from_chars(pos, end, value);
+        if (result.ec != errc()) {
+            return false;
+        }
+        pos = result.ptr;
+        return true;
+    }
+
+    static void WriteBinary(string& out, double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        AppendLittleEndian(out, bits, 8);
+    }
+
+    static bool ReadBinary(const char*& pos, const char* end, double& value) {
+        uint64_t bits;
+        if (!ReadLittleEndian(pos, end, bits, 8)) {
+            return false;
+        }
+        memcpy(&value, &bits, sizeof(value));
+        return true;
+    }
+};
+
+template <>
+struct FieldCodec<string> {
+    // Separators, backslashes and line breaks are escaped with a backslash so
+    // a comma in a name or message can't shift the columns of a row
+    static void WriteText(string& out, const string& value) {
+        size_t start = 0;
+        for (size_t i = 0; i < value.size(); i++) {
+            char ch = value[i];
+            if (ch != ',' && ch != '\\' && ch != '\n' && ch != '\r') {
+                continue;
+            }
+            out.append(value, start, i - start);
+            out += '\\';
+            out += (ch == '\n') ? 'n' : (ch == '\r') ? 'r' : ch;
+            start = i + 1;
+        }
+        out.append(value, start, string::npos);
+    }
+
+    static bool ReadText(const char*& pos, const char* end, string& value) {
+        value.clear();
+        while (pos != end && *pos != ',') {
+            const char* run = pos;
+            while (pos != end && *pos != ',' && *pos != '\\') {
+                pos++;
+            }
+            value.append(run, pos);
+            if (pos == end || *pos == ',') {
+                break;
+            }
+            if (++pos == end) {
+                return false; // Dangling escape
+            }
+            value += (*pos == 'n') ? '\n' : (*pos == 'r') ? '\r' : *pos;
+            pos++;
+        }
+        return true;
+    }
+
+    static void WriteBinary(string& out, const string& value) {
+        AppendLittleEndian(out, (uint32_t) value.size(), 4);
+        out.append(value);
+    }
+
+    static bool ReadBinary(const char*& pos, const char* end, string& value) {
+        uint64_t length;
+        if (!ReadLittleEndian(pos, end, length, 4) || (uint64_t) (end - pos) < length) {
+            return false;
+        }
+        value.assign(pos, length);
+        pos += length;
+        return true;
+    }
+};
+
+// Compile-time checks on a schema
+template <typename T, typename = void>
+struct HasFieldCodec : false_type {};
+
+template <typename T>
+struct HasFieldCodec<T, decltype((void) sizeof(FieldCodec<T>))> : true_type {};
+
+template <typename Record, typename T>
+constexpr FieldCodec<T> FieldCodecFor(const Field<Record, T>&) {
+    return FieldCodec<T>();
+}
+
+constexpr bool SameName(const char* a, const char* b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+template <typename Record, typename... T>
+constexpr bool HasUniqueNames(const tuple<Field<Record, T>...>& schema) {
+    const char* names[sizeof...(T)] = {};
+    size_t count = 0;
+    apply([&](const auto&... field) {
+        ((names[count++] = field.name), ...);
+    }, schema);
+    for (size_t i = 0; i < sizeof...(T); i++) {
+        if (names[i] == nullptr || *names[i] == '\0') {
+            return false;
+        }
+        for (size_t j = i + 1; j < sizeof...(T); j++) {
+            if (SameName(names[i], names[j])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template <typename Record, typename... T>
+constexpr bool HasCodecs(const tuple<Field<Record, T>...>&) {
+    return (HasFieldCodec<T>::value && ...);
+}
+
+template <typename Record>
+constexpr size_t ColumnCount() {
+    return tuple_size<decltype(Record::Schema())>::value;
+}
+
+// Generated serializers and parsers. The Append* functions write into a
+// caller-owned buffer so a reused buffer never reallocates once warm.
+template <typename Record>
+void AppendRecordText(const Record& record, string& out) {
+    bool first = true;
+    apply([&](const auto&... field) {
+        ((first ? (void) (first = false) : (void) (out += ','),
+          FieldCodecFor(field).WriteText(out, record.*field.member)), ...);
+    }, Record::Schema());
+}
+
+template <typename Record>
+bool ParseRecordText(string_view line, Record& record) {
+    const char* pos = line.data();
+    const char* end = pos + line.size();
+    bool ok = true;
+    bool first = true;
+    apply([&](const auto&... field) {
+        ((ok = ok && (first || (pos != end && *pos++ == ','))
+                  && FieldCodecFor(field).ReadText(pos, end, record.*field.member)
+                  && (pos == end || *pos == ','),
+          first = false), ...);
+    }, Record::Schema());
+    return ok && pos == end;
+}
+
+template <typename Record>
+void AppendRecordBinary(const Record& record, string& out) {
+    apply([&](const auto&... field) {
+        (FieldCodecFor(field).WriteBinary(out, record.*field.member), ...);
+    }, Record::Schema());
+}
+
+template <typename Record>
+bool ParseRecordBinary(const char*& pos, const char* end, Record& record) {
+    bool ok = true;
+    apply([&](const auto&... field) {
+        ((ok = ok && FieldCodecFor(field).ReadBinary(pos, end, record.*field.member)), ...);
+    }, Record::Schema());
+    return ok;
+}
+
+//// Classes  ////
+
+class TransactionHistory {
+private:
+    string type;
+    string date;
+    string message;
+    double balance;
+    double amount;
+    int accID;
+
+public:
+    // Column layout of a history.txt row
+    static constexpr auto Schema() {
+        return MakeSchema(MakeField("accID", &TransactionHistory::accID),
+                          MakeField("type", &TransactionHistory::type),
+                          MakeField("amount", &TransactionHistory::amount),
+                          MakeField("message", &TransactionHistory::message),
+                          MakeField("balance", &TransactionHistory::balance),
+                          MakeField("date", &TransactionHistory::date));
+    }
+
+    // Default constructor
+    TransactionHistory()
+        : type(""), date(""), message(""), amount(0.0), accID(-1), balance(0.0) {}
+
+    // Parameterized constructor
+    TransactionHistory(const string& type_, const string& message_,
+                       const double amount_, const string& date_,
+                       const int id, const double balance_)
+        : type(type_), message(message_), amount(amount_), date(date_), accID(id), balance(balance_) {}
+
+    // Constructor to create a TransactionHistory object from a formatted string
+    TransactionHistory(const string& line) : TransactionHistory() {
+        if (!ParseRecordText(line, *this)) {
+            throw runtime_error("ERROR: Malformed transaction record: " + line);
+        }
+    }
+
+    // Convert a TransactionHistory object to a formatted string
+    string ToString() const {
+        string line;
+        AppendRecordText(*this, line);
+        return line;
+    }
+
+    // Print transaction details
+    void Print() const {
+        cout << "\n ---------------------\n\n";
+        cout << type << " $" << amount << " - Balance: $" << balance << endl << message << date;
+        cout << "\n ---------------------\n";
+    }
+
+    // Get the account ID associated with this transaction
+    int GetAccountID() const {
+        return accID;
+    }
+
+    // Get the transaction type ("Deposit", "Transfer", ...)
+    const string& GetType() const {
+        return type;
+    }
+
+    // Get the amount moved
+    double GetAmount() const {
+        return amount;
+    }
+
+    // Get the date the transaction was made
+    const string& GetDate() const {
+        return date;
+    }
+
+    // Get the transaction message
+    const string& GetMessage() const {
+        return message;
+    }
+};
+
+class Account {
+private:
+    int accountID;
+    double balance;
+    // Rows are never modified once added, so copies of the account and
+    // snapshots share them instead of copying
+    vector<shared_ptr<const TransactionHistory>> transactionHistory;
+
+public:
+    // Column layout of an accounts.txt row
+    static constexpr auto Schema() {
+        return MakeSchema(MakeField("accountID", &Account::accountID),
+                          MakeField("balance", &Account::balance));
+    }
+
+    // Default constructor
+    Account() : accountID(-1), balance(0.0) {}
+
+    // Constructor to initialize an Account object from a line of text
+    Account(const string& line) : Account() {
+        if (!ParseRecordText(line, *this)) {
+            throw runtime_error("ERROR: Malformed account record: " + line);
+        }
+    }
+
+    // Add a transaction to the account's transaction history
+    void AddTransaction(const TransactionHistory& transaction) {
+        transactionHistory.push_back(make_shared<const TransactionHistory>(transaction));
+    }
+
+    void AddTransaction(TransactionHistory&& transaction) {
+        transactionHistory.push_back(make_shared<const TransactionHistory>(move(transaction)));
+    }
+
+    // Get the transaction history as a vector of strings
+    vector<string> GetTransactionHistory() {
+        vector<string> transactionLines;
+        for (auto& transaction : transactionHistory) {
+            transactionLines.push_back(transaction->ToString());
+        }
+        return transactionLines;
+    }
+
+    // Read-only access to the stored transactions
+    const vector<shared_ptr<const TransactionHistory>>& GetTransactions() const {
+        return transactionHistory;
+    }
+
+    // Print account information
+    void PrintInfo() {
+        PrintInfo(accountID, balance);
+    }
+
+    static void PrintInfo(int accountID, double balance) {
+        cout << "\t-> Account Details <-\n";
+        cout << "-> Account ID: " << accountID << "\n";
+        cout << "-> Account Balance: $" << balance << "\n\n";
+    }
+
+    // Print transaction history
+    void PrintTransactionHistory() {
+        if (transactionHistory.empty()) {
+            cout << "\n\t->-> Transaction history is empty! <-<-\n";
+            return;
+        }
+        cout << "\n\t->-> Transaction History <-<-\n";
+
+        for (auto& transaction : transactionHistory) {
+            transaction->Print();
+        }
+    }
+
+    // Convert Account object to a string for storage
+    string ToString() const {
+        string line;
+        AppendRecordText(*this, line);
+        return line;
+    }
+
+    // Update the account balance
+    void UpdateBalance(double newBalance) {
+        balance += newBalance;
+    }
+
+    // Setter for balance
+    void SetBalance(double balance_) {
+        balance = balance_;
+    }
+
+    // Setter for account ID
+    void SetAccountID(int id_) {
+        accountID = id_;
+    }
+
+    // Getter for account ID
+    const int& GetAccountID() const {
+        return accountID;
+    }
+
+    // Getter for balance
+    double& GetBalance() {
+        return balance;
+    }
+
+    const double& GetBalance() const {
+        return balance;
+    }
+
+};
+
+class User {
+private:
+    string firstName;
+    string lastName;
+    string email;
+    string userName;
+    string password;
+    int accID;
+
+public:
+    // Column layout of a users.txt row
+    static constexpr auto Schema() {
+        return MakeSchema(MakeField("firstName", &User::firstName),
+                          MakeField("lastName", &User::lastName),
+                          MakeField("email", &User::email),
+                          MakeField("userName", &User::userName),
+                          MakeField("password", &User::password),
+                          MakeField("accID", &User::accID));
+    }
+
+    // Default constructor
+    User() : firstName(""), lastName(""), email(""), userName(""), password(""), accID(-1) {}
+
+    // Constructor to initialize a User object from a line of text
+    User(const string& line) : User() {
+        if (!ParseRecordText(line, *this)) {
+            throw runtime_error("ERROR: Malformed user record: " + line);
+        }
+    }
+
+    // Read user data and initialize a User object
+    void ReadData(const string& newUserName, int newAccountID) {
+        accID = newAccountID;
+        userName = newUserName;
+        // Input and validate the user's password
+        while (true) {
+            cout << "\nEnter your password \n(at least 8 characters with numbers, characters,\n special characters, and an uppercase letter): ";
+            cin >> password;
+
+            if (ValidatePassword(password)) {
+                string confirmPassword;
+                cout << "\nConfirm your password: ";
+                cin >> confirmPassword;
+
+                if (password == confirmPassword) {
+                    break;
+                } else {
+                    cout << "Passwords do not match. Please try again." << endl;
+                }
+            } else {
+                cout << "\n->-> Invalid password format. Please try again. <-<-\n" << endl;
+            }
+        }
+
+        cout << "Enter First Name: ";
+        cin >> firstName;
+        cout << "Enter Last Name: ";
+        cin >> lastName;
+        cout << "Enter Email: ";
+        cin >> email;
+
+    } 
+
+    
+    // Getters for user attributes
+    const string &GetUserName() const {
+        return userName;
+    }
+    
+    int GetAccountID(){
+        return accID;
+    }
+
+    const string &GetPassword() const {
+        return password;
+    }
+
+    // Setters for user attributes
+    void ChangeFirstName(string fname) {
+        firstName = fname;
+    }
+
+    void ChangeLastName(string lname) {
+        lastName = lname;
+    }
+
+    void ChangeEmail(string email_) {
+        email = email_;
+    }
+
+    void ChangeUserName(string user_name) {
+        userName = user_name;
+    }
+
+    void ChangePassword(string pass) {
+        password = pass;
+    }
+
+    // Convert User object to a string for storage
+    string ToString() const {
+        string line;
+        AppendRecordText(*this, line);
+        return line;
+    }
+
+    // Print user information
+    void PrintInfo() const {
+        cout << "\t->-> Personal Details <-<-\n";
+        cout << "Mr/s: " << firstName << " " << lastName << endl;
+        cout << "Email: " << email << "\nUser Name: " << userName << endl;
+        cout << "Account Number: " << accID << endl;
+    }
+
+    // Get the account ID of the user
+    const int GetAccID() const {
+        return accID;
+    }
+
+};
+
+// The on-disk layouts are fixed; a schema edit that changes them must be deliberate
+static_assert(ColumnCount<TransactionHistory>() == 6 && HasUniqueNames(TransactionHistory::Schema())
+              && HasCodecs(TransactionHistory::Schema()), "Invalid TransactionHistory schema");
+static_assert(ColumnCount<Account>() == 2 && HasUniqueNames(Account::Schema())
+              && HasCodecs(Account::Schema()), "Invalid Account schema");
+static_assert(ColumnCount<User>() == 6 && HasUniqueNames(User::Schema())
+              && HasCodecs(User::Schema()), "Invalid User schema");
+
+//// Snapshots  ////
+
+// A run of an account's transactions. Chunks are immutable once published
+// and link back to the older ones, so every version of an account shares
+// the history it had in common with the previous version. The rows
+// themselves are shared with the live Account, not copied.
+struct HistoryChunk {
+    vector<shared_ptr<const TransactionHistory>> rows;
+    shared_ptr<const HistoryChunk> older;
+    size_t total; // Rows in this chunk and all older ones
+};
+
+// The committed state of an account as of one commit. Never modified once
+// published, except for cutting the link to versions no reader can need.
+struct AccountVersion {
+    long long commit;
+    int accountID;
+    double balance;
+    shared_ptr<const HistoryChunk> history; // Freed with the last version using it
+    mutable atomic<const AccountVersion*> older;
+
+    AccountVersion(long long commit_, int accountID_, double balance_,
+                   shared_ptr<const HistoryChunk> history_, const AccountVersion* older_)
+        : commit(commit_), accountID(accountID_), balance(balance_), history(move(history_)), older(older_) {}
+};
+
+// Multi-version account state. The single writer publishes new versions at
+// every commit; readers pin a commit number and see every account exactly as
+// it was at that commit, without taking any lock the writer needs. Versions
+// that no pinned reader can reach are unlinked and freed once every reader
+// that might still be walking them has unpinned (epoch-based reclamation,
+// with commit numbers as the epochs).
+class SnapshotStore {
+private:
+    static const int kMaxReaders = 64;
+    static const long long kIdle = -1;
+
+    struct alignas(64) ReaderSlot {
+        atomic<long long> commit{kIdle};
+    };
+
+    struct Chain {
+        atomic<const AccountVersion*> head{nullptr};
+    };
+
+    atomic<long long> lastCommit{0};
+    ReaderSlot readers[kMaxReaders];
+
+    // Readers only take it shared to find an account; the writer takes it
+    // exclusively only to add a new account
+    mutable shared_mutex directoryMutex;
+    map<int, unique_ptr<Chain>> chains;
+
+    // Writer only
+    set<int> withOlderVersions;
+    deque<pair<long long, const AccountVersion*>> retired; // In commit order
+    long long trimmedTo = 0; // Oldest pin the chains were last trimmed for
+
+    Chain* ChainFor(int accountID) {
+        auto found = chains.find(accountID);
+        if (found != chains.end()) {
+            return found->second.get();
+        }
+        unique_lock<shared_mutex> lock(directoryMutex);
+        return chains.emplace(accountID, make_unique<Chain>()).first->second.get();
+    }
+
+    // Oldest commit any reader is pinned at; `commit` if nobody is reading
+    long long OldestPinned(long long commit) const {
+        long long oldest = commit;
+        for (const ReaderSlot& reader : readers) {
+            long long pinned = reader.commit.load();
+            if (pinned != kIdle) {
+                oldest = min(oldest, pinned);
+            }
+        }
+        return oldest;
+    }
+
+    // Unlink versions older than the one the oldest reader needs, then free
+    // retired versions no reader can still be walking. While the oldest pin
+    // stays put there is nothing new to unlink, so the chains are only
+    // walked when it moves forward; a long report costs commits nothing.
+    void Reclaim(long long commit) {
+        long long oldest = OldestPinned(commit);
+        if (oldest <= trimmedTo) {
+            FreeRetired(commit);
+            return;
+        }
+        trimmedTo = oldest;
+        for (auto it = withOlderVersions.begin(); it != withOlderVersions.end();) {
+            const AccountVersion* keep = chains[*it]->head.load(memory_order_relaxed);
+            while (keep->commit > oldest && keep->older.load(memory_order_relaxed)) {
+                keep = keep->older.load(memory_order_relaxed);
+            }
+            const AccountVersion* stale = keep->older.exchange(nullptr);
+            while (stale) {
+                retired.emplace_back(commit, stale);
+                stale = stale->older.load(memory_order_relaxed);
+            }
+            bool single = chains[*it]->head.load(memory_order_relaxed)->older.load(memory_order_relaxed) == nullptr;
+            it = single ? withOlderVersions.erase(it) : next(it);
+        }
+        FreeRetired(commit);
+    }
+
+    void FreeRetired(long long commit) {
+        long long oldest = OldestPinned(commit + 1);
+        while (!retired.empty() && retired.front().first < oldest) {
+            delete retired.front().second;
+            retired.pop_front();
+        }
+    }
+
+    friend class Snapshot;
+
+public:
+    SnapshotStore() = default;
+    SnapshotStore(const SnapshotStore&) = delete;
+    SnapshotStore& operator=(const SnapshotStore&) = delete;
+
+    ~SnapshotStore() {
+        for (auto& chainPair : chains) {
+            const AccountVersion* version = chainPair.second->head.load();
+            while (version) {
+                const AccountVersion* older = version->older.load();
+                delete version;
+                version = older;
+            }
+        }
+        for (auto& entry : retired) {
+            delete entry.second;
+        }
+    }
+
+    // Publish the current state of the accounts in `changed` as one commit.
+    // Accounts whose balance and history are unchanged get no new version.
+    // New rows go into a new chunk, which absorbs older chunks that aren't
+    // larger than it, so an account has O(log rows) chunks and each row
+    // pointer is copied O(log rows) times in total.
+    void Publish(const map<int, Account>& accounts, const vector<int>& changed) {
+        long long commit = lastCommit.load() + 1;
+        bool published = false;
+        for (int accountID : changed) {
+            auto found = accounts.find(accountID);
+            if (found == accounts.end()) {
+                continue;
+            }
+            const Account& account = found->second;
+            Chain* chain = ChainFor(accountID);
+            const AccountVersion* head = chain->head.load(memory_order_relaxed);
+            shared_ptr<const HistoryChunk> history = head ? head->history : nullptr;
+            size_t publishedRows = history ? history->total : 0;
+            const vector<shared_ptr<const TransactionHistory>>& rows = account.GetTransactions();
+            if (head && head->balance == account.GetBalance() && publishedRows == rows.size()) {
+                continue;
+            }
+
+            if (rows.size() != publishedRows) {
+                // Histories only grow; anything else is republished in full
+                size_t from = rows.size() > publishedRows ? publishedRows : 0;
+                if (from == 0) {
+                    history = nullptr;
+                }
+                while (history && history->rows.size() <= rows.size() - from) {
+                    from -= history->rows.size();
+                    history = history->older;
+                }
+                history = make_shared<const HistoryChunk>(HistoryChunk{
+                    vector<shared_ptr<const TransactionHistory>>(rows.begin() + from, rows.end()), history, rows.size() });
+            }
+
+            chain->head.store(new AccountVersion(commit, accountID, account.GetBalance(), move(history), head), memory_order_release);
+            if (head) {
+                withOlderVersions.insert(accountID);
+            }
+            published = true;
+        }
+
+        if (published) {
+            lastCommit.store(commit);
+            Reclaim(commit);
+        }
+    }
+};
+
+// A consistent view of every account as of one commit. Hold it for as long
+// as the report runs; writers keep committing meanwhile. It may be shared by
+// several threads of the same report.
+class Snapshot {
+private:
+    SnapshotStore& store;
+    int slot;
+    long long commit;
+
+public:
+    Snapshot(SnapshotStore& store_) : store(store_), slot(-1), commit(0) {
+        // Claim a reader slot, then re-check the commit so the writer can't
+        // have reclaimed past it between the read and the announcement
+        for (int i = 0; slot < 0; i = (i + 1) % SnapshotStore::kMaxReaders) {
+            long long idle = SnapshotStore::kIdle;
+            if (store.readers[i].commit.compare_exchange_strong(idle, store.lastCommit.load())) {
+                slot = i;
+            }
+        }
+        while (true) {
+            commit = store.readers[slot].commit.load();
+            long long latest = store.lastCommit.load();
+            if (latest == commit) {
+                break;
+            }
+            store.readers[slot].commit.store(latest);
+        }
+    }
+
+    ~Snapshot() {
+        store.readers[slot].commit.store(SnapshotStore::kIdle);
+    }
+
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+    long long GetCommit() const {
+        return commit;
+    }
+
+    // The account as of this snapshot, or nullptr if it didn't exist yet
+    const AccountVersion* Find(int accountID) const {
+        const SnapshotStore::Chain* chain;
+        {
+            shared_lock<shared_mutex> lock(store.directoryMutex);
+            auto found = store.chains.find(accountID);
+            if (found == store.chains.end()) {
+                return nullptr;
+            }
+            chain = found->second.get();
+        }
+        const AccountVersion* version = chain->head.load(memory_order_acquire);
+        while (version && version->commit > commit) {
+            version = version->older.load(memory_order_acquire);
+        }
+        return version;
+    }
+
+    // Every account that existed at this snapshot, in account ID order
+    vector<const AccountVersion*> Accounts() const {
+        vector<int> ids;
+        {
+            shared_lock<shared_mutex> lock(store.directoryMutex);
+            ids.reserve(store.chains.size());
+            for (const auto& chainPair : store.chains) {
+                ids.push_back(chainPair.first);
+            }
+        }
+        vector<const AccountVersion*> versions;
+        versions.reserve(ids.size());
+        for (int accountID : ids) {
+            if (const AccountVersion* version = Find(accountID)) {
+                versions.push_back(version);
+            }
+        }
+        return versions;
+    }
+
+    // Call visit(transaction) for the account's history, oldest first
+    template <typename Visit>
+    static void ForEachTransaction(const AccountVersion& version, Visit visit) {
+        vector<const HistoryChunk*> chunks;
+        for (const HistoryChunk* chunk = version.history.get(); chunk; chunk = chunk->older.get()) {
+            chunks.push_back(chunk);
+        }
+        for (auto it = chunks.rbegin(); it != chunks.rend(); ++it) {
+            for (const auto& transaction : (*it)->rows) {
+                visit(*transaction);
+            }
+        }
+    }
+
+    static size_t TransactionCount(const AccountVersion& version) {
+        return version.history ? version.history->total : 0;
+    }
+};
+
+// Output file with a single large fixed-size buffer. Rows are formatted
+// straight into the buffer and only full buffers reach the file, so there is
+// no per-row flush or allocation.
+class BufferedFileWriter {
+private:
+    ofstream file;
+    vector<char> buffer;
+    size_t used;
+
+public:
+    static const size_t kBufferSize = 1 << 16;
+
+    BufferedFileWriter(const string& path, bool append = false)
+        : file(path, ios::out | ios::binary | (append ? ios::app : ios::trunc)), buffer(kBufferSize), used(0) {
+        if (!file.is_open()) {
+            throw runtime_error("ERROR: Can't open the file");
+        }
+    }
+
+    // Best effort only; call Close() to find out whether the data reached the file
+    ~BufferedFileWriter() {
+        if (file.is_open()) {
+            file.write(buffer.data(), used);
+        }
+    }
+
+    // Make sure at least `bytes` are free in the buffer (bytes <= kBufferSize)
+    char* Reserve(size_t bytes) {
+        if (kBufferSize - used < bytes) {
+            Flush();
+        }
+        return buffer.data() + used;
+    }
+
+    void Commit(char* end) {
+        used = end - buffer.data();
+    }
+
+    void Write(const char* data, size_t size) {
+        while (size > 0) {
+            size_t chunk = min(size, kBufferSize - used);
+            if (chunk == 0) {
+                Flush();
+                continue;
+            }
+            memcpy(buffer.data() + used, data, chunk);
+            used += chunk;
+            data += chunk;
+            size -= chunk;
+        }
+    }
+
+    void Write(string_view text) {
+        Write(text.data(), text.size());
+    }
+
+    void Put(char ch) {
+        *Reserve(1) = ch;
+        used++;
+    }
+
+    void Flush() {
+        if (used > 0) {
+            file.write(buffer.data(), used);
+            used = 0;
+            if (!file.good()) {
+                throw runtime_error("ERROR: Can't write to the file");
+            }
+        }
+    }
+
+    // Flush and close, throwing if any write failed (e.g. the disk is full)
+    void Close() {
+        Flush();
+        file.close();
+        if (file.fail()) {
+            throw runtime_error("ERROR: Can't write to the file");
+        }
+    }
+};
+
+enum class StatementFormat { CSV, JSON, FixedWidth };
+
+// Writes account statements from the in-memory transaction history. Columns
+// come from TransactionHistory::Schema(), so the statement follows the record
+// layout without a second hand-written list of fields.
+class StatementExporter {
+private:
+    StatementFormat format;
+    long long fromKey; // -1 means no lower bound
+    long long toKey;   // -1 means no upper bound
+
+    // Fixed-width column widths, in schema order
+    static constexpr int kColumnWidths[] = { 10, 10, 14, 30, 14, 26 };
+    static_assert(sizeof(kColumnWidths) / sizeof(kColumnWidths[0]) == ColumnCount<TransactionHistory>(),
+                  "One fixed-width column per TransactionHistory field");
+
+    bool InRange(const TransactionHistory& transaction) const {
+        if (fromKey < 0 && toKey < 0) {
+            return true;
+        }
+        long long key = DateKey(transaction.GetDate());
+        return key >= 0 && (fromKey < 0 || key >= fromKey) && (toKey < 0 || key <= toKey);
+    }
+
+    // Format a number without touching the heap; money is shown with 2 decimals
+    static size_t FormatNumber(char* out, size_t size, int value) {
+        return to_chars(out, out + size, value).ptr - out;
+    }
+
+    static size_t FormatNumber(char* out, size_t size, double value) {
+        return to_chars(out, out + size, value, chars_format::fixed, 2).ptr - out;
+    }
+
+    template <typename T>
+    static void WriteCsvValue(BufferedFileWriter& out, const T& value) {
+        char* pos = out.Reserve(32);
+        out.Commit(pos + FormatNumber(pos, 32, value));
+    }
+
+    static void WriteCsvValue(BufferedFileWriter& out, const string& value) {
+        if (value.find_first_of(",\"\r\n") == string::npos) {
+            out.Write(value);
+            return;
+        }
+        out.Put('"');
+        for (char ch : value) {
+            if (ch == '"') {
+                out.Put('"');
+            }
+            out.Put(ch);
+        }
+        out.Put('"');
+    }
+
+    template <typename T>
+    static void WriteJsonValue(BufferedFileWriter& out, const T& value) {
+        WriteCsvValue(out, value);
+    }
+
+    static void WriteJsonValue(BufferedFileWriter& out, const string& value) {
+        static const char* hex = "0123456789abcdef";
+        out.Put('"');
+        for (char ch : value) {
+            if (ch == '"' || ch == '\\') {
+                out.Put('\\');
+                out.Put(ch);
+            } else if (ch == '\n') {
+                out.Write("\\n");
+            } else if ((unsigned char) ch < 0x20) {
+                out.Write("\\u00");
+                out.Put(hex[(ch >> 4) & 0xF]);
+                out.Put(hex[ch & 0xF]);
+            } else {
+                out.Put(ch);
+            }
+        }
+        out.Put('"');
+    }
+
+    // Numbers are right aligned, text is left aligned and cut to the column width;
+    // columns are separated by a single space
+    template <typename T>
+    static void WriteFixedValue(BufferedFileWriter& out, const T& value, int width) {
+        char digits[32];
+        size_t length = FormatNumber(digits, sizeof(digits), value);
+        char* pos = out.Reserve(width + sizeof(digits));
+        for (int i = (int) length; i < width; i++) {
+            *pos++ = ' ';
+        }
+        memcpy(pos, digits, length);
+        out.Commit(pos + length);
+    }
+
+    static void WriteFixedValue(BufferedFileWriter& out, const string& value, int width) {
+        char* pos = out.Reserve(width);
+        for (int i = 0; i < width; i++) {
+            char ch = i < (int) value.size() ? value[i] : ' ';
+            *pos++ = (ch == '\n' || ch == '\r') ? ' ' : ch;
+        }
+        out.Commit(pos);
+    }
+
+    void WriteHeader(BufferedFileWriter& out, int accountID) const {
+        size_t column = 0;
+        switch (format) {
+            case StatementFormat::CSV:
+                apply([&](const auto&... field) {
+                    ((out.Write(column++ ? "," : ""), out.Write(field.name)), ...);
+                }, TransactionHistory::Schema());
+                out.Put('\n');
+                break;
+            case StatementFormat::JSON:
+                out.Write("{\"accountID\":");
+                WriteJsonValue(out, accountID);
+                out.Write(",\"transactions\":[");
+                break;
+            case StatementFormat::FixedWidth:
+                apply([&](const auto&... field) {
+                    ((out.Write(column ? " " : ""), WriteFixedValue(out, string(field.name), kColumnWidths[column++])), ...);
+                }, TransactionHistory::Schema());
+                out.Put('\n');
+                break;
+        }
+    }
+
+    void WriteRow(BufferedFileWriter& out, const TransactionHistory& transaction, bool first) const {
+        size_t column = 0;
+        switch (format) {
+            case StatementFormat::CSV:
+                apply([&](const auto&... field) {
+                    ((out.Write(column++ ? "," : ""), WriteCsvValue(out, transaction.*field.member)), ...);
+                }, TransactionHistory::Schema());
+                out.Put('\n');
+                break;
+            case StatementFormat::JSON:
+                out.Write(first ? "\n{" : ",\n{");
+                apply([&](const auto&... field) {
+                    ((out.Write(column++ ? ",\"" : "\""), out.Write(field.name), out.Write("\":"),
+                      WriteJsonValue(out, transaction.*field.member)), ...);
+                }, TransactionHistory::Schema());
+                out.Put('}');
+                break;
+            case StatementFormat::FixedWidth:
+                apply([&](const auto&... field) {
+                    ((out.Write(column ? " " : ""), WriteFixedValue(out, transaction.*field.member, kColumnWidths[column++])), ...);
+                }, TransactionHistory::Schema());
+                out.Put('\n');
+                break;
+        }
+    }
+
+    void WriteFooter(BufferedFileWriter& out) const {
+        if (format == StatementFormat::JSON) {
+            out.Write("\n]}\n");
+        }
+    }
+
+    // forEach(visit) calls visit() for each of the account's transactions in order
+    template <typename ForEach>
+    size_t ExportRows(int accountID, const string& path, ForEach forEach) const {
+        BufferedFileWriter out(path);
+        WriteHeader(out, accountID);
+        size_t rows = 0;
+        forEach([&](const TransactionHistory& transaction) {
+            if (InRange(transaction)) {
+                WriteRow(out, transaction, rows == 0);
+                rows++;
+            }
+        });
+        WriteFooter(out);
+        out.Close();
+        return rows;
+    }
+
+public:
+    // Empty dates ("") leave that end of the range open
+    StatementExporter(StatementFormat format_, const string& fromDay = "", const string& toDay = "")
+        : format(format_),
+          fromKey(fromDay.empty() ? -1 : DayKey(fromDay, false)),
+          toKey(toDay.empty() ? -1 : DayKey(toDay, true)) {
+        if ((!fromDay.empty() && fromKey < 0) || (!toDay.empty() && toKey < 0)) {
+            throw runtime_error("ERROR: Dates must be in the form YYYY-MM-DD");
+        }
+    }
+
+    // File extension matching the output format
+    const char* Extension() const {
+        switch (format) {
+            case StatementFormat::CSV:
+                return ".csv";
+            case StatementFormat::JSON:
+                return ".json";
+            default:
+                return ".txt";
+        }
+    }
+
+    // Stream one account's statement to a file; returns the number of rows written
+    size_t Export(const Account& account, const string& path) const {
+        return ExportRows(account.GetAccountID(), path, [&](auto visit) {
+            for (const auto& transaction : account.GetTransactions()) {
+                visit(*transaction);
+            }
+        });
+    }
+
+    // Same, from the account's state in a snapshot
+    size_t Export(const AccountVersion& account, const string& path) const {
+        return ExportRows(account.accountID, path, [&](auto visit) {
+            Snapshot::ForEachTransaction(account, visit);
+        });
+    }
+
+    // Export every account of the snapshot into `directory` as
+    // statement_<id><ext>, spreading the accounts over all available cores
+    size_t ExportAll(const Snapshot& snapshot, const string& directory) const {
+        vector<const AccountVersion*> work = snapshot.Accounts();
+
+        atomic<size_t> next(0), rows(0);
+        exception_ptr failure;
+        mutex failureMutex;
+        auto worker = [&]() {
+            for (size_t i = next++; i < work.size(); i = next++) {
+                string path = directory + "/statement_" + to_string(work[i]->accountID) + Extension();
+                try {
+                    rows += Export(*work[i], path);
+                } catch (...) {
+                    lock_guard<mutex> lock(failureMutex);
+                    if (!failure) {
+                        failure = current_exception();
+                    }
+                }
+            }
+        };
+
+        size_t threadCount = max(1u, thread::hardware_concurrency());
+        threadCount = min(threadCount, max<size_t>(1, work.size()));
+        vector<thread> threads;
+        for (size_t i = 1; i < threadCount; i++) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (thread& t : threads) {
+            t.join();
+        }
+        if (failure) {
+            rethrow_exception(failure);
+        }
+        return rows;
+    }
+};
+
+// Hierarchical timer wheel keyed by whole seconds. Four levels of 256 slots
+// cover 2^32 seconds; an entry sits in the coarsest level that still
+// separates it from the current tick and is moved down a level each time the
+// finer level wraps, so inserting and finding due entries is O(1) per entry.
+class TimerWheel {
+public:
+    struct Entry {
+        uint32_t id;
+        long long due;
+    };
+
+private:
+    static const int kLevels = 4;
+    static const int kSlotBits = 8;
+    static const int kSlots = 1 << kSlotBits;
+
+    vector<Entry> slots[kLevels][kSlots];
+    long long currentTick;
+    size_t entryCount;
+
+    void Place(const Entry& entry) {
+        long long delta = entry.due - currentTick;
+        int level = 0;
+        while (level < kLevels - 1 && delta >= (1LL << (kSlotBits * (level + 1)))) {
+            level++;
+        }
+        slots[level][(entry.due >> (kSlotBits * level)) & (kSlots - 1)].push_back(entry);
+    }
+
+    // Re-place every entry of a coarse slot now that the finer levels have wrapped
+    void Cascade(int level) {
+        vector<Entry> moving;
+        moving.swap(slots[level][(currentTick >> (kSlotBits * level)) & (kSlots - 1)]);
+        for (const Entry& entry : moving) {
+            Place(entry);
+        }
+    }
+
+public:
+    TimerWheel() : currentTick(0), entryCount(0) {}
+
+    // Drop all entries and restart the wheel at `tick`
+    void Reset(long long tick) {
+        for (auto& level : slots) {
+            for (auto& slot : level) {
+                vector<Entry>().swap(slot);
+            }
+        }
+        currentTick = tick;
+        entryCount = 0;
+    }
+
+    // Entries due at or before the current tick fire on the next tick
+    void Insert(uint32_t id, long long due) {
+        Place(Entry{id, max(due, currentTick + 1)});
+        entryCount++;
+    }
+
+    long long CurrentTick() const {
+        return currentTick;
+    }
+
+    // Move the wheel forward to `tick`, calling fire(tick, entries) for every
+    // tick that has entries due. fire() may insert new entries.
+    template <typename Fire>
+    void AdvanceTo(long long tick, Fire fire) {
+        vector<Entry> due;
+        while (currentTick < tick) {
+            if (entryCount == 0) {
+                currentTick = tick;
+                break;
+            }
+            currentTick++;
+            for (int level = kLevels - 1; level > 0; level--) {
+                if ((currentTick & ((1LL << (kSlotBits * level)) - 1)) == 0) {
+                    Cascade(level);
+                }
+            }
+            due.clear();
+            due.swap(slots[0][currentTick & (kSlots - 1)]);
+            if (!due.empty()) {
+                entryCount -= due.size();
+                fire(currentTick, due);
+            }
+        }
+    }
+};
+
+enum StandingOrderPeriod { Once = 0, Daily = 1, Weekly = 2, Monthly = 3 };
+
+// A transfer that runs once at a future date or repeats on a schedule
+class StandingOrder {
+private:
+    int orderID;
+    int senderAccountID;
+    string senderUserName;
+    string receiverUserName;
+    double amount;
+    long long nextDue;  // seconds since the epoch
+    int period;         // StandingOrderPeriod
+    int dayOfMonth;     // Day monthly orders are paid on, from the first due date
+
+public:
+    // Column layout of an orders.txt row
+    static constexpr auto Schema() {
+        return MakeSchema(MakeField("orderID", &StandingOrder::orderID),
+                          MakeField("senderAccountID", &StandingOrder::senderAccountID),
+                          MakeField("senderUserName", &StandingOrder::senderUserName),
+                          MakeField("receiverUserName", &StandingOrder::receiverUserName),
+                          MakeField("amount", &StandingOrder::amount),
+                          MakeField("nextDue", &StandingOrder::nextDue),
+                          MakeField("period", &StandingOrder::period),
+                          MakeField("dayOfMonth", &StandingOrder::dayOfMonth));
+    }
+
+    // Default constructor
+    StandingOrder() : orderID(-1), senderAccountID(-1), amount(0.0), nextDue(0), period(Once), dayOfMonth(1) {}
+
+    // Parameterized constructor
+    StandingOrder(int senderAccountID_, const string& senderUserName_, const string& receiverUserName_,
+                  double amount_, long long firstDue, int period_)
+        : orderID(-1), senderAccountID(senderAccountID_), senderUserName(senderUserName_),
+          receiverUserName(receiverUserName_), amount(amount_), nextDue(firstDue), period(period_),
+          dayOfMonth(LocalTime((time_t) firstDue).tm_mday) {}
+
+    // Constructor to create a StandingOrder object from a formatted string
+    StandingOrder(const string& line) : StandingOrder() {
+        if (!ParseRecordText(line, *this)) {
+            throw runtime_error("ERROR: Malformed standing order record: " + line);
+        }
+    }
+
+    // Convert a StandingOrder object to a formatted string
+    string ToString() const {
+        string line;
+        AppendRecordText(*this, line);
+        return line;
+    }
+
+    // The occurrence after `due` at the same local wall-clock time, or -1 for
+    // one-off orders. Monthly orders keep the day of the month of their first
+    // payment, moved back to the last day of shorter months.
+    long long NextOccurrence(long long due) const {
+        if (period == Once) {
+            return -1;
+        }
+        tm date = LocalTime((time_t) due);
+        if (period == Monthly) {
+            tm lastDay = {};
+            lastDay.tm_year = date.tm_year;
+            lastDay.tm_mon = date.tm_mon + 2;
+            lastDay.tm_mday = 0; // Day 0 is the last day of the month before
+            lastDay.tm_isdst = -1;
+            mktime(&lastDay);
+            date.tm_mon += 1;
+            date.tm_mday = min(dayOfMonth, lastDay.tm_mday);
+        } else {
+            date.tm_mday += period == Weekly ? 7 : 1;
+        }
+        // mktime() normalises the date and keeps the wall-clock time across daylight saving changes
+        date.tm_isdst = -1;
+        return (long long) mktime(&date);
+    }
+
+    // Print order details
+    void Print() const {
+        static const char* periods[] = { "Once", "Daily", "Weekly", "Monthly" };
+        cout << "\n ---------------------\n\n";
+        cout << "Order #" << orderID << ": $" << amount << " to (" << receiverUserName << ") "
+             << periods[period] << "\nNext: " << FormatTime((time_t) nextDue);
+        cout << "\n ---------------------\n";
+    }
+
+    // Getters and setters
+    int GetOrderID() const {
+        return orderID;
+    }
+
+    void SetOrderID(int id_) {
+        orderID = id_;
+    }
+
+    int GetSenderAccountID() const {
+        return senderAccountID;
+    }
+
+    const string& GetSenderUserName() const {
+        return senderUserName;
+    }
+
+    const string& GetReceiverUserName() const {
+        return receiverUserName;
+    }
+
+    void RenameUser(const string& oldName, const string& newName) {
+        if (senderUserName == oldName) {
+            senderUserName = newName;
+        }
+        if (receiverUserName == oldName) {
+            receiverUserName = newName;
+        }
+    }
+
+    double GetAmount() const {
+        return amount;
+    }
+
+    long long GetNextDue() const {
+        return nextDue;
+    }
+
+    void SetNextDue(long long due) {
+        nextDue = due;
+    }
+};
+
+static_assert(ColumnCount<StandingOrder>() == 8 && HasUniqueNames(StandingOrder::Schema())
+              && HasCodecs(StandingOrder::Schema()), "Invalid StandingOrder schema");
+
+// One occurrence of a standing order that has come due
+struct DueOrder {
+    const StandingOrder* order;
+    long long due;
+};
+
+// Keeps every standing order and finds the due ones through a TimerWheel.
+// The schedule is rebuilt from each order's persisted next due time, so after
+// downtime the missed occurrences are replayed in (due time, order ID) order.
+class StandingOrderScheduler {
+private:
+    vector<StandingOrder> orders; // Cancelled and finished orders are dropped on the next Load()
+    vector<bool> active;
+    TimerWheel wheel;
+    int lastOrderID;
+
+public:
+    StandingOrderScheduler() : lastOrderID(0) {}
+
+    void Load(const string& path, long long now) {
+        orders.clear();
+        active.clear();
+        lastOrderID = 0;
+
+        vector<string> lines;
+        try {
+            lines = ReadFile(path);
+        } catch (const runtime_error&) {
+            // No standing orders have been saved yet
+        }
+
+        long long start = now;
+        for (const string& line : lines) {
+            StandingOrder order(line);
+            lastOrderID = max(lastOrderID, order.GetOrderID());
+            start = min(start, order.GetNextDue() - 1);
+            orders.push_back(order);
+            active.push_back(true);
+        }
+
+        wheel.Reset(start);
+        for (size_t i = 0; i < orders.size(); i++) {
+            wheel.Insert((uint32_t) i, orders[i].GetNextDue());
+        }
+    }
+
+    // Replace the file in one rename, so a crash never leaves half a schedule
+    void Save(const string& path) const {
+        vector<string> lines;
+        lines.reserve(orders.size());
+        for (size_t i = 0; i < orders.size(); i++) {
+            if (active[i]) {
+                lines.push_back(orders[i].ToString());
+            }
+        }
+        string temporaryPath = path + ".tmp";
+        WriteFile(temporaryPath, lines, false);
+        if (rename(temporaryPath.c_str(), path.c_str()) != 0) {
+            throw runtime_error("ERROR: Can't replace the file " + path);
+        }
+    }
+
+    // Schedule a new order and return its ID. An order already due runs on
+    // the next tick, and that becomes its recorded due time.
+    int Add(StandingOrder order) {
+        order.SetOrderID(++lastOrderID);
+        order.SetNextDue(max(order.GetNextDue(), wheel.CurrentTick() + 1));
+        orders.push_back(order);
+        active.push_back(true);
+        wheel.Insert((uint32_t) (orders.size() - 1), order.GetNextDue());
+        return order.GetOrderID();
+    }
+
+    // Cancel one of the account's orders; its wheel entry is skipped when it fires
+    bool Cancel(int orderID, int accountID) {
+        for (size_t i = 0; i < orders.size(); i++) {
+            if (active[i] && orders[i].GetOrderID() == orderID && orders[i].GetSenderAccountID() == accountID) {
+                active[i] = false;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    vector<const StandingOrder*> OrdersFor(int accountID) const {
+        vector<const StandingOrder*> result;
+        for (size_t i = 0; i < orders.size(); i++) {
+            if (active[i] && orders[i].GetSenderAccountID() == accountID) {
+                result.push_back(&orders[i]);
+            }
+        }
+        return result;
+    }
+
+    void RenameUser(const string& oldName, const string& newName) {
+        for (StandingOrder& order : orders) {
+            order.RenameUser(oldName, newName);
+        }
+    }
+
+    // Fire everything due up to `now`, handing the occurrences to
+    // executeBatch() in chronological batches of at most batchSize.
+    // Returns the number of occurrences that came due.
+    template <typename ExecuteBatch>
+    size_t RunDue(long long now, size_t batchSize, ExecuteBatch executeBatch) {
+        vector<DueOrder> batch;
+        size_t fired = 0;
+        wheel.AdvanceTo(now, [&](long long tick, vector<TimerWheel::Entry>& entries) {
+            sort(entries.begin(), entries.end(), [&](const TimerWheel::Entry& a, const TimerWheel::Entry& b) {
+                return orders[a.id].GetOrderID() < orders[b.id].GetOrderID();
+            });
+            for (const TimerWheel::Entry& entry : entries) {
+                StandingOrder& order = orders[entry.id];
+                if (!active[entry.id] || order.GetNextDue() != tick) {
+                    continue; // Cancelled since it was scheduled
+                }
+                batch.push_back(DueOrder{&order, tick});
+                fired++;
+
+                long long next = order.NextOccurrence(tick);
+                if (next < 0) {
+                    active[entry.id] = false;
+                } else {
+                    order.SetNextDue(next);
+                    wheel.Insert(entry.id, next);
+                }
+
+                if (batch.size() >= batchSize) {
+                    executeBatch(batch);
+                    batch.clear();
+                }
+            }
+        });
+        if (!batch.empty()) {
+            executeBatch(batch);
+        }
+        return fired;
+    }
+};
+
+// One row of rates.txt: accounts whose balance is at least minBalance (and
+// below the next tier) earn annualRate and pay dailyFee every end of day
+class RateTier {
+private:
+    double minBalance;
+    double annualRate;
+    double dailyFee;
+
+public:
+    // Column layout of a rates.txt row
+    static constexpr auto Schema() {
+        return MakeSchema(MakeField("minBalance", &RateTier::minBalance),
+                          MakeField("annualRate", &RateTier::annualRate),
+                          MakeField("dailyFee", &RateTier::dailyFee));
+    }
+
+    // Default constructor
+    RateTier() : minBalance(0.0), annualRate(0.0), dailyFee(0.0) {}
+
+    // Constructor to create a RateTier object from a formatted string
+    RateTier(const string& line) : RateTier() {
+        if (!ParseRecordText(line, *this)) {
+            throw runtime_error("ERROR: Malformed rate tier record: " + line);
+        }
+    }
+
+    double GetMinBalance() const {
+        return minBalance;
+    }
+
+    double GetAnnualRate() const {
+        return annualRate;
+    }
+
+    double GetDailyFee() const {
+        return dailyFee;
+    }
+};
+
+static_assert(ColumnCount<RateTier>() == 3 && HasUniqueNames(RateTier::Schema())
+              && HasCodecs(RateTier::Schema()), "Invalid RateTier schema");
+
+// Nightly interest and maintenance-fee postings for every account. Postings
+// are computed in parallel over contiguous balance arrays, applied to the
+// accounts in parallel (each thread owns a disjoint range), and then
+// committed with one append to history.txt and one rewrite of accounts.txt
+// instead of an UpdateDatabase() per account.
+class EndOfDayJob {
+private:
+    vector<double> tierMinimums; // Ascending
+    vector<double> tierDailyRates;
+    vector<double> tierFees;
+
+    static double RoundToCents(double value) {
+        return floor(value * 100.0 + 0.5) / 100.0;
+    }
+
+    // Highest tier whose minimum the balance reaches, or kNoTier if it is
+    // below every tier
+    static const size_t kNoTier = (size_t) -1;
+
+    size_t TierFor(double balance) const {
+        size_t tier = kNoTier;
+        for (size_t i = 0; i < tierMinimums.size(); i++) {
+            tier += balance >= tierMinimums[i];
+        }
+        return tier;
+    }
+
+    // Replace the marker file in one rename
+    static void WriteMarker(const string& markerPath, const string& businessDay, const string& state) {
+        string temporaryPath = markerPath + ".tmp";
+        WriteFile(temporaryPath, { businessDay + "," + state }, false);
+        if (rename(temporaryPath.c_str(), markerPath.c_str()) != 0) {
+            throw runtime_error("ERROR: Can't replace the file " + markerPath);
+        }
+    }
+
+    // Run body(begin, end) over [0, count) split into one range per core
+    template <typename Body>
+    static void ParallelFor(size_t count, Body body) {
+        size_t threadCount = max(1u, thread::hardware_concurrency());
+        threadCount = min(threadCount, max<size_t>(1, count / 4096));
+        size_t chunk = (count + threadCount - 1) / threadCount;
+        vector<thread> threads;
+        for (size_t t = 1; t < threadCount; t++) {
+            threads.emplace_back(body, min(count, t * chunk), min(count, (t + 1) * chunk));
+        }
+        body(0, min(count, chunk));
+        for (thread& worker : threads) {
+            worker.join();
+        }
+    }
+
+public:
+    EndOfDayJob(vector<RateTier> tiers, int daysPerYear = 365) {
+        if (tiers.empty()) {
+            throw runtime_error("ERROR: At least one rate tier is required");
+        }
+        sort(tiers.begin(), tiers.end(), [](const RateTier& a, const RateTier& b) {
+            return a.GetMinBalance() < b.GetMinBalance();
+        });
+        for (const RateTier& tier : tiers) {
+            tierMinimums.push_back(tier.GetMinBalance());
+            tierDailyRates.push_back(tier.GetAnnualRate() / daysPerYear);
+            tierFees.push_back(tier.GetDailyFee());
+        }
+    }
+
+    // Load the tiers from a rates file
+    static EndOfDayJob FromFile(const string& path) {
+        vector<RateTier> tiers;
+        for (const string& line : ReadFile(path)) {
+            tiers.push_back(RateTier(line));
+        }
+        return EndOfDayJob(tiers);
+    }
+
+    // The marker file holds "<business day>,<committing|done>" for the last
+    // run that reached its commit point, or "<last posted day>,appending,
+    // <history size>" while a run is adding rows to the history. Returns ""
+    // if no day was posted.
+    static string LastPostedDay(const string& markerPath) {
+        vector<string> lines;
+        try {
+            lines = ReadFile(markerPath);
+        } catch (const runtime_error&) {
+            return "";
+        }
+        return lines.empty() ? "" : SplitString(lines[0])[0];
+    }
+
+    // Finish a run that stopped after its commit point by moving the new
+    // balances into place, or undo a run that stopped before it by cutting
+    // the history back to its old size and discarding the staged balances
+    static void Recover(const string& markerPath, const string& historyPath, const string& accountsPath) {
+        vector<string> lines;
+        try {
+            lines = ReadFile(markerPath);
+        } catch (const runtime_error&) {
+            // No end of day has run yet
+        }
+        vector<string> marker = lines.empty() ? vector<string>() : SplitString(lines[0]);
+        string staged = accountsPath + ".eod";
+        if (marker.size() == 2 && marker[1] == "committing") {
+            if (rename(staged.c_str(), accountsPath.c_str()) != 0 && errno != ENOENT) {
+                throw runtime_error("ERROR: Can't replace the file " + accountsPath);
+            }
+            WriteMarker(markerPath, marker[0], "done");
+            return;
+        }
+        remove(staged.c_str());
+        if (marker.size() == 3 && marker[1] == "appending") {
+            if (truncate(historyPath.c_str(), (off_t) stoll(marker[2])) != 0 && errno != ENOENT) {
+                throw runtime_error("ERROR: Can't restore the file " + historyPath);
+            }
+            WriteMarker(markerPath, marker[0], "done");
+        }
+    }
+
+    struct Summary {
+        size_t accounts = 0;
+        size_t interestPostings = 0;
+        size_t feePostings = 0;
+        double totalInterest = 0.0;
+        double totalFees = 0.0;
+    };
+
+    // Post interest and fees for `businessDay` (YYYY-MM-DD) to every account
+    // in memory, then commit them to the history and accounts files. The
+    // rows are appended to the history after the marker records its size,
+    // and the balances are staged next to accounts.txt until the marker
+    // records the day as committing, so a crash at any point leaves either
+    // none or all of the postings after Recover(). The cost follows the
+    // number of accounts, not the length of the history. A day is posted
+    // at most once.
+    Summary Run(map<int, Account>& accounts, const string& businessDay, const string& transactionDate,
+                const string& markerPath, const string& historyPath, const string& accountsPath) const {
+        Recover(markerPath, historyPath, accountsPath);
+        string lastPosted = LastPostedDay(markerPath);
+        if (!lastPosted.empty() && businessDay <= lastPosted) {
+            throw runtime_error("ERROR: End of day has already been posted for " + lastPosted);
+        }
+
+        vector<Account*> refs;
+        vector<double> balances;
+        refs.reserve(accounts.size());
+        balances.reserve(accounts.size());
+        for (auto& accountPair : accounts) {
+            refs.push_back(&accountPair.second);
+            balances.push_back(accountPair.second.GetBalance());
+        }
+
+        // Compute the postings; fees never take a balance below zero
+        size_t count = balances.size();
+        vector<double> interest(count), fees(count);
+        ParallelFor(count, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                size_t tier = TierFor(balances[i]);
+                if (tier == kNoTier) {
+                    interest[i] = fees[i] = 0.0;
+                    continue;
+                }
+                double earned = balances[i] > 0 ? RoundToCents(balances[i] * tierDailyRates[tier]) : 0.0;
+                interest[i] = earned;
+                fees[i] = min(tierFees[tier], max(0.0, balances[i] + earned));
+            }
+        });
+
+        // Append the new rows to the history. Each range formats into its
+        // own small buffer and hands full buffers to the shared writer, so
+        // memory stays flat; an account's rows always stay in order.
+        string stagedAccounts = accountsPath + ".eod";
+        struct stat historyStat;
+        off_t historySize = stat(historyPath.c_str(), &historyStat) == 0 ? historyStat.st_size : 0;
+        WriteMarker(markerPath, lastPosted, "appending," + to_string((long long) historySize));
+        {
+            BufferedFileWriter history(historyPath, true);
+            if (historySize > 0) {
+                ifstream current(historyPath, ios::binary);
+                current.seekg(historySize - 1);
+                if (current.get() != '\n') {
+                    history.Put('\n');
+                }
+            }
+
+            mutex historyMutex;
+            exception_ptr failure;
+            ParallelFor(count, [&](size_t begin, size_t end) {
+                string rows;
+                rows.reserve(BufferedFileWriter::kBufferSize + 256);
+                for (size_t i = begin; i < end; i++) {
+                    Account& account = *refs[i];
+                    if (interest[i] > 0) {
+                        account.SetBalance(RoundToCents(account.GetBalance() + interest[i]));
+                        TransactionHistory posting("Interest", "", interest[i], transactionDate, account.GetAccountID(), account.GetBalance());
+                        AppendRecordText(posting, rows);
+                        rows += '\n';
+                        account.AddTransaction(move(posting));
+                    }
+                    if (fees[i] > 0) {
+                        account.SetBalance(RoundToCents(account.GetBalance() - fees[i]));
+                        TransactionHistory posting("Fee", "", fees[i], transactionDate, account.GetAccountID(), account.GetBalance());
+                        AppendRecordText(posting, rows);
+                        rows += '\n';
+                        account.AddTransaction(move(posting));
+                    }
+                    if (rows.size() >= BufferedFileWriter::kBufferSize || (i + 1 == end && !rows.empty())) {
+                        lock_guard<mutex> lock(historyMutex);
+                        try {
+                            if (!failure) {
+                                history.Write(rows);
+                            }
+                        } catch (...) {
+                            failure = current_exception();
+                        }
+                        rows.clear();
+                    }
+                }
+            });
+            if (failure) {
+                rethrow_exception(failure);
+            }
+            history.Close();
+        }
+
+        // Stage the balances
+        {
+            BufferedFileWriter balancesOut(stagedAccounts);
+            string line;
+            for (const Account* account : refs) {
+                line.clear();
+                AppendRecordText(*account, line);
+                line += '\n';
+                balancesOut.Write(line);
+            }
+            balancesOut.Close();
+        }
+
+        // Commit point: once the marker says "committing", Recover() finishes the job
+        WriteMarker(markerPath, businessDay, "committing");
+        Recover(markerPath, historyPath, accountsPath);
+
+        Summary summary;
+        summary.accounts = count;
+        for (size_t i = 0; i < count; i++) {
+            summary.interestPostings += interest[i] > 0;
+            summary.feePostings += fees[i] > 0;
+            summary.totalInterest += interest[i];
+            summary.totalFees += fees[i];
+        }
+        return summary;
+    }
+};
+
+// Sum and count of the events in the last `window` seconds, kept in
+// kBuckets ring buckets. The buckets are sized so the kBuckets - 1 full ones
+// behind the newest cover at least the window; the sum may include up to one
+// bucket more than the window, never less. Old buckets are
+// dropped from the running totals as time moves on, so adding and reading
+// are O(1) and never look at the transaction history.
+class VelocityWindow {
+private:
+    static const int kBuckets = 16;
+
+    struct Bucket {
+        long long slot;
+        uint32_t count;
+        double amount;
+    };
+
+    Bucket buckets[kBuckets];
+    long long width;    // Seconds per bucket
+    long long headSlot; // Newest slot seen
+    uint32_t totalCount;
+    double totalAmount;
+
+    void Advance(long long slot) {
+        if (slot <= headSlot) {
+            return;
+        }
+        long long steps = min<long long>(slot - headSlot, kBuckets);
+        for (long long next = slot - steps + 1; next <= slot; next++) {
+            Bucket& bucket = buckets[next % kBuckets];
+            totalCount -= bucket.count;
+            totalAmount -= bucket.amount;
+            bucket = Bucket{next, 0, 0.0};
+        }
+        if (totalCount == 0) {
+            totalAmount = 0.0; // Don't let rounding errors pile up
+        }
+        headSlot = slot;
+    }
+
+public:
+    VelocityWindow(long long windowSeconds = kBuckets)
+        : width(max<long long>(1, (windowSeconds + kBuckets - 2) / (kBuckets - 1))),
+          headSlot(0), totalCount(0), totalAmount(0.0) {
+        for (Bucket& bucket : buckets) {
+            bucket = Bucket{0, 0, 0.0};
+        }
+    }
+
+    void Add(long long now, double amount) {
+        long long slot = now / width;
+        Advance(slot);
+        if (slot <= headSlot - kBuckets) {
+            return; // Already outside the window
+        }
+        Bucket& bucket = buckets[slot % kBuckets];
+        bucket.count++;
+        bucket.amount += amount;
+        totalCount++;
+        totalAmount += amount;
+    }
+
+    uint32_t Count(long long now) {
+        Advance(now / width);
+        return totalCount;
+    }
+
+    double Amount(long long now) {
+        Advance(now / width);
+        return totalAmount;
+    }
+};
+
+// Credits to a hot account are spread over per-core slots, each on its own
+// cache line, so concurrent credits never write the same line. Amounts are
+// kept in the same units as Account::balance, so a hot account ends up with
+// the same balance a cold one would, fractions of a cent included.
+struct alignas(64) CreditSlot {
+    atomic<double> amount{0.0};
+};
+
+// Merchant and payroll accounts that receive many transfers are promoted
+// automatically once they take about promoteAfter credits within
+// windowSeconds. Credits to other accounts are counted in kStripes stripes,
+// each with its own lock, so ordinary credits only contend with credits to
+// accounts in the same stripe.
+// Credits to them only add to the calling core's slot; the slots are folded
+// into the real balance lazily by Fold(), and Pending() gives debits the
+// exact amount not folded yet. Promotion is permanent for the life of the
+// process (at most kMaxHotAccounts), so a credit never races a demotion.
+class HotAccountLedger {
+private:
+    static const int kMaxHotAccounts = 64;
+
+    struct HotAccount {
+        atomic<int> accountID{-1};
+        unique_ptr<CreditSlot[]> slots;
+    };
+
+    // Credits in the current and the previous fixed window; the rate over
+    // the last windowSeconds is estimated from both
+    struct CreditRate {
+        long long windowStart;
+        uint32_t previous;
+        uint32_t current;
+    };
+
+    static const int kStripes = 64;
+
+    struct alignas(64) DetectStripe {
+        mutex lock;
+        unordered_map<int, CreditRate> rates;
+        long long lastSweep = 0;
+    };
+
+    HotAccount hot[kMaxHotAccounts];
+    atomic<int> hotCount{0};
+    size_t slotCount; // Power of two
+    uint32_t promoteAfter;
+    int windowSeconds;
+    mutex promoteMutex; // Only taken when an account is promoted
+    DetectStripe stripes[kStripes];
+
+    // Each thread keeps the slot it was first given
+    size_t SlotIndex() const {
+        static atomic<unsigned> nextIndex{0};
+        thread_local unsigned index = nextIndex++;
+        return index & (slotCount - 1);
+    }
+
+    const HotAccount* Find(int accountID) const {
+        int count = hotCount.load(memory_order_acquire);
+        for (int i = 0; i < count; i++) {
+            if (hot[i].accountID.load(memory_order_relaxed) == accountID) {
+                return &hot[i];
+            }
+        }
+        return nullptr;
+    }
+
+    // Count a credit to an account that isn't hot and promote it if it has
+    // become busy. Accounts idle for a whole window are dropped.
+    void Observe(int accountID, long long now) {
+        DetectStripe& stripe = stripes[(unsigned) accountID % kStripes];
+        {
+            lock_guard<mutex> lock(stripe.lock);
+            if (now - stripe.lastSweep >= windowSeconds) {
+                for (auto it = stripe.rates.begin(); it != stripe.rates.end();) {
+                    it = now - it->second.windowStart >= 2LL * windowSeconds ? stripe.rates.erase(it) : next(it);
+                }
+                stripe.lastSweep = now;
+            }
+
+            long long windowStart = now - now % windowSeconds;
+            CreditRate& rate = stripe.rates.try_emplace(accountID, CreditRate{windowStart, 0, 0}).first->second;
+            if (rate.windowStart != windowStart) {
+                rate.previous = windowStart - rate.windowStart == windowSeconds ? rate.current : 0;
+                rate.current = 0;
+                rate.windowStart = windowStart;
+            }
+            rate.current++;
+            double previousShare = 1.0 - (double) (now - windowStart) / windowSeconds;
+            if (rate.current + rate.previous * previousShare < promoteAfter) {
+                return;
+            }
+            stripe.rates.erase(accountID);
+        }
+
+        lock_guard<mutex> lock(promoteMutex);
+        int count = hotCount.load(memory_order_relaxed);
+        if (Find(accountID) || count == kMaxHotAccounts) {
+            return;
+        }
+        hot[count].slots.reset(new CreditSlot[slotCount]);
+        hot[count].accountID.store(accountID, memory_order_relaxed);
+        hotCount.store(count + 1, memory_order_release);
+    }
+
+public:
+    HotAccountLedger(uint32_t promoteAfter_ = 100, int windowSeconds_ = 60)
+        : slotCount(1), promoteAfter(promoteAfter_), windowSeconds(max(1, windowSeconds_)) {
+        size_t cores = max(1u, thread::hardware_concurrency());
+        while (slotCount < cores && slotCount < 64) {
+            slotCount <<= 1;
+        }
+    }
+
+    // Take a credit for a hot account and return true; return false if the
+    // account isn't hot and the caller must update the balance itself
+    bool Credit(int accountID, double amount, long long now) {
+        const HotAccount* account = Find(accountID);
+        if (account == nullptr) {
+            Observe(accountID, now);
+            return false;
+        }
+        // Only this core adds to its slot, so the loop almost never retries
+        atomic<double>& slot = account->slots[SlotIndex()].amount;
+        double current = slot.load(memory_order_relaxed);
+        while (!slot.compare_exchange_weak(current, current + amount, memory_order_relaxed)) {
+        }
+        return true;
+    }
+
+    bool IsHot(int accountID) const {
+        return Find(accountID) != nullptr;
+    }
+
+    // Credits taken but not folded into the balance yet
+    double Pending(int accountID) const {
+        const HotAccount* account = Find(accountID);
+        if (account == nullptr) {
+            return 0.0;
+        }
+        double pending = 0.0;
+        for (size_t i = 0; i < slotCount; i++) {
+            pending += account->slots[i].amount.load(memory_order_relaxed);
+        }
+        return pending;
+    }
+
+    // Move every pending credit into the account balances; returns the
+    // accounts whose balance changed
+    vector<int> Fold(map<int, Account>& accounts) {
+        vector<int> changed;
+        int count = hotCount.load(memory_order_acquire);
+        for (int i = 0; i < count; i++) {
+            double pending = 0.0;
+            for (size_t j = 0; j < slotCount; j++) {
+                pending += hot[i].slots[j].amount.exchange(0.0, memory_order_relaxed);
+            }
+            if (pending != 0.0) {
+                int accountID = hot[i].accountID.load(memory_order_relaxed);
+                accounts[accountID].UpdateBalance(pending);
+                changed.push_back(accountID);
+            }
+        }
+        return changed;
+    }
+};
+
+// One row of rules.txt. `operation` is Withdraw, Transfer or Any; `metric`
+// is amount (sum over the window), count (operations in the window) or
+// newReceiver (largest transfer to someone the account never paid before,
+// windowSeconds unused).
+class VelocityRule {
+private:
+    string name;
+    string operation;
+    string metric;
+    int windowSeconds;
+    double limit;
+
+public:
+    // Column layout of a rules.txt row
+    static constexpr auto Schema() {
+        return MakeSchema(MakeField("name", &VelocityRule::name),
+                          MakeField("operation", &VelocityRule::operation),
+                          MakeField("metric", &VelocityRule::metric),
+                          MakeField("windowSeconds", &VelocityRule::windowSeconds),
+                          MakeField("limit", &VelocityRule::limit));
+    }
+
+    // Default constructor
+    VelocityRule() : windowSeconds(0), limit(0.0) {}
+
+    // Constructor to create a VelocityRule object from a formatted string
+    VelocityRule(const string& line) : VelocityRule() {
+        if (!ParseRecordText(line, *this)) {
+            throw runtime_error("ERROR: Malformed rule record: " + line);
+        }
+        if (metric != "amount" && metric != "count" && metric != "newReceiver") {
+            throw runtime_error("ERROR: Unknown rule metric: " + metric);
+        }
+    }
+
+    bool AppliesTo(const string& operation_) const {
+        return operation == "Any" || operation == operation_;
+    }
+
+    // Rules that need a sliding window per account
+    bool IsWindowed() const {
+        return metric != "newReceiver";
+    }
+
+    // Same rule and same window, so its collected state can be kept on reload
+    bool SameWindow(const VelocityRule& other) const {
+        return name == other.name && metric == other.metric && windowSeconds == other.windowSeconds;
+    }
+
+    const string& GetName() const {
+        return name;
+    }
+
+    const string& GetMetric() const {
+        return metric;
+    }
+
+    int GetWindowSeconds() const {
+        return windowSeconds;
+    }
+
+    double GetLimit() const {
+        return limit;
+    }
+};
+
+static_assert(ColumnCount<VelocityRule>() == 5 && HasUniqueNames(VelocityRule::Schema())
+              && HasCodecs(VelocityRule::Schema()), "Invalid VelocityRule schema");
+
+// Per-account velocity limits checked inline on every withdrawal and
+// transfer. rules.txt is re-read when it changes (checked at most once a
+// second) and per-rule evaluation counts and latency are written to
+// rule_stats.txt at most once a second and when the engine is destroyed.
+// An account's windows start from its recent history, so restarting the
+// program doesn't reset its limits.
+class FraudRuleEngine {
+private:
+    struct RuleStats {
+        unsigned long long evaluations = 0;
+        unsigned long long declines = 0;
+        long long totalNanoseconds = 0;
+        long long maxNanoseconds = 0;
+    };
+
+    string rulesPath;
+    string statsPath;
+    time_t rulesModified;
+    time_t lastCheck;
+    time_t lastStatsWrite;
+    bool statsDirty;
+    vector<VelocityRule> rules;
+    vector<unordered_map<int, VelocityWindow>> windows; // Per rule, per account
+    vector<RuleStats> stats;
+    unordered_map<int, unordered_set<string>> knownReceivers;
+
+    void Reload() {
+        vector<VelocityRule> loaded;
+        try {
+            for (const string& line : ReadFile(rulesPath)) {
+                loaded.push_back(VelocityRule(line));
+            }
+        } catch (const runtime_error&) {
+            return; // Keep the current rules if the file is missing or being edited
+        }
+
+        vector<unordered_map<int, VelocityWindow>> keptWindows(loaded.size());
+        vector<RuleStats> keptStats(loaded.size());
+        for (size_t i = 0; i < loaded.size(); i++) {
+            for (size_t j = 0; j < rules.size(); j++) {
+                if (rules[j].SameWindow(loaded[i])) {
+                    keptWindows[i].swap(windows[j]);
+                    keptStats[i] = stats[j];
+                    break;
+                }
+            }
+        }
+        rules.swap(loaded);
+        windows.swap(keptWindows);
+        stats.swap(keptStats);
+    }
+
+    void WriteStats() {
+        vector<string> lines;
+        for (size_t i = 0; i < rules.size(); i++) {
+            const RuleStats& rule = stats[i];
+            long long average = rule.evaluations ? rule.totalNanoseconds / (long long) rule.evaluations : 0;
+            lines.push_back(rules[i].GetName() + "," + to_string(rule.evaluations) + "," + to_string(rule.declines)
+                            + "," + to_string(average) + "," + to_string(rule.maxNanoseconds));
+        }
+        WriteFile(statsPath, lines, false);
+    }
+
+    // Reload changed rules, at most once per second
+    void Poll(time_t now) {
+        if (now == lastCheck) {
+            return;
+        }
+        lastCheck = now;
+        struct stat info;
+        if (stat(rulesPath.c_str(), &info) == 0 && info.st_mtime != rulesModified) {
+            rulesModified = info.st_mtime;
+            Reload();
+        }
+    }
+
+    // Receivers this account has paid before, read once from its history
+    unordered_set<string>& ReceiversOf(const Account& account) {
+        auto found = knownReceivers.find(account.GetAccountID());
+        if (found != knownReceivers.end()) {
+            return found->second;
+        }
+        unordered_set<string>& receivers = knownReceivers[account.GetAccountID()];
+        for (const auto& transaction : account.GetTransactions()) {
+            const string& message = transaction->GetMessage();
+            size_t open = message.find(" to (");
+            size_t close = message.find(')', open);
+            if (open != string::npos && close != string::npos) {
+                receivers.insert(message.substr(open + 5, close - open - 5));
+            }
+        }
+        return receivers;
+    }
+
+    // The account's window for a rule, filled from the history rows still
+    // inside it the first time it is needed. The history is in date order,
+    // so only its tail is read, newest first, up to the window's start.
+    VelocityWindow& WindowFor(size_t rule, const Account& account, long long now) {
+        auto& accounts = windows[rule];
+        auto found = accounts.find(account.GetAccountID());
+        if (found != accounts.end()) {
+            return found->second;
+        }
+        VelocityWindow& window = accounts.emplace(account.GetAccountID(), VelocityWindow(rules[rule].GetWindowSeconds())).first->second;
+        const auto& transactions = account.GetTransactions();
+        for (auto it = transactions.rbegin(); it != transactions.rend(); ++it) {
+            const string& type = (*it)->GetType();
+            if ((type != "Withdraw" && type != "Transfer") || !rules[rule].AppliesTo(type)) {
+                continue;
+            }
+            time_t when = ParseTime((*it)->GetDate());
+            if (when <= now - rules[rule].GetWindowSeconds()) {
+                break;
+            }
+            if (when <= now) {
+                window.Add(when, (*it)->GetAmount());
+            }
+        }
+        return window;
+    }
+
+public:
+    FraudRuleEngine(const string& rulesPath_ = "rules.txt", const string& statsPath_ = "rule_stats.txt")
+        : rulesPath(rulesPath_), statsPath(statsPath_), rulesModified(0), lastCheck(0), lastStatsWrite(0), statsDirty(false) {}
+
+    ~FraudRuleEngine() {
+        try {
+            FlushStats();
+        } catch (const runtime_error&) {
+            // Nowhere left to report it
+        }
+    }
+
+    // Write the stats collected since the last write
+    void FlushStats() {
+        if (statsDirty) {
+            WriteStats();
+            statsDirty = false;
+            lastStatsWrite = time(0);
+        }
+    }
+
+    // Check an operation against every rule. `receiver` is empty for
+    // withdrawals. Transfers prepared but not yet committed (and so not yet
+    // recorded) count against the windows as well. Returns false and the
+    // rule's name if it is declined.
+    bool Allow(const string& operation, const Account& account, const string& receiver,
+               double amount, long long now, string& declinedBy,
+               uint32_t pendingTransfers = 0, double pendingTransferAmount = 0.0) {
+        Poll(time(0));
+        bool allowed = true;
+        for (size_t i = 0; i < rules.size() && allowed; i++) {
+            const VelocityRule& rule = rules[i];
+            if (!rule.AppliesTo(operation)) {
+                continue;
+            }
+            auto start = chrono::steady_clock::now();
+            bool countsPending = rule.AppliesTo("Transfer");
+
+            if (rule.GetMetric() == "amount") {
+                double pending = countsPending ? pendingTransferAmount : 0.0;
+                allowed = WindowFor(i, account, now).Amount(now) + pending + amount <= rule.GetLimit();
+            } else if (rule.GetMetric() == "count") {
+                uint32_t pending = countsPending ? pendingTransfers : 0;
+                allowed = WindowFor(i, account, now).Count(now) + pending + 1 <= rule.GetLimit();
+            } else if (!receiver.empty()) {
+                allowed = amount <= rule.GetLimit() || ReceiversOf(account).count(receiver) > 0;
+            }
+
+            long long elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+            RuleStats& ruleStats = stats[i];
+            ruleStats.evaluations++;
+            ruleStats.totalNanoseconds += elapsed;
+            ruleStats.maxNanoseconds = max(ruleStats.maxNanoseconds, elapsed);
+            if (!allowed) {
+                ruleStats.declines++;
+                declinedBy = rule.GetName();
+            }
+        }
+        statsDirty = true;
+        if (time(0) != lastStatsWrite) {
+            FlushStats();
+        }
+        return allowed;
+    }
+
+    // Count an operation that went through towards the account's windows.
+    // Call it before the operation's row is added to the account's history.
+    void Record(const string& operation, const Account& account, const string& receiver, double amount, long long now) {
+        for (size_t i = 0; i < rules.size(); i++) {
+            if (rules[i].AppliesTo(operation) && rules[i].IsWindowed()) {
+                WindowFor(i, account, now).Add(now, amount);
+            }
+        }
+        if (!receiver.empty()) {
+            ReceiversOf(account).insert(receiver);
+        }
+    }
+};
+
+//// Sharding  ////
+
+// One row of shards.txt: the shard owning account IDs firstAccountID to
+// lastAccountID, the directory holding its data files and its socket
+class ShardInfo {
+private:
+    int firstAccountID;
+    int lastAccountID;
+    string dataDirectory;
+    string socketPath;
+
+public:
+    // Column layout of a shards.txt row
+    static constexpr auto Schema() {
+        return MakeSchema(MakeField("firstAccountID", &ShardInfo::firstAccountID),
+                          MakeField("lastAccountID", &ShardInfo::lastAccountID),
+                          MakeField("dataDirectory", &ShardInfo::dataDirectory),
+                          MakeField("socketPath", &ShardInfo::socketPath));
+    }
+
+    // Default constructor
+    ShardInfo() : firstAccountID(0), lastAccountID(-1) {}
+
+    // Constructor to create a ShardInfo object from a formatted string
+    ShardInfo(const string& line) : ShardInfo() {
+        if (!ParseRecordText(line, *this)) {
+            throw runtime_error("ERROR: Malformed shard record: " + line);
+        }
+    }
+
+    // Convert a ShardInfo object to a formatted string
+    string ToString() const {
+        string line;
+        AppendRecordText(*this, line);
+        return line;
+    }
+
+    bool Owns(int accountID) const {
+        return accountID >= firstAccountID && accountID <= lastAccountID;
+    }
+
+    const string& GetDataDirectory() const {
+        return dataDirectory;
+    }
+
+    const string& GetSocketPath() const {
+        return socketPath;
+    }
+};
+
+// A debit reserved by PREPARE and not yet committed or aborted, kept in the
+// shard's pending.txt so it survives a restart
+class PendingDebit {
+private:
+    long long txID;
+    int accountID;
+    int receiverAccountID;
+    double amount;
+
+public:
+    // Column layout of a pending.txt row
+    static constexpr auto Schema() {
+        return MakeSchema(MakeField("txID", &PendingDebit::txID),
+                          MakeField("accountID", &PendingDebit::accountID),
+                          MakeField("receiverAccountID", &PendingDebit::receiverAccountID),
+                          MakeField("amount", &PendingDebit::amount));
+    }
+
+    // Default constructor
+    PendingDebit() : txID(-1), accountID(-1), receiverAccountID(-1), amount(0.0) {}
+
+    // Parameterized constructor
+    PendingDebit(long long txID_, int accountID_, int receiverAccountID_, double amount_)
+        : txID(txID_), accountID(accountID_), receiverAccountID(receiverAccountID_), amount(amount_) {}
+
+    // Constructor to create a PendingDebit object from a formatted string
+    PendingDebit(const string& line) : PendingDebit() {
+        if (!ParseRecordText(line, *this)) {
+            throw runtime_error("ERROR: Malformed pending debit record: " + line);
+        }
+    }
+
+    // Convert a PendingDebit object to a formatted string
+    string ToString() const {
+        string line;
+        AppendRecordText(*this, line);
+        return line;
+    }
+
+    long long GetTxID() const {
+        return txID;
+    }
+
+    int GetAccountID() const {
+        return accountID;
+    }
+
+    int GetReceiverAccountID() const {
+        return receiverAccountID;
+    }
+
+    double GetAmount() const {
+        return amount;
+    }
+};
+
+// One step of a cross-shard transfer in the router's transfers.log. The last
+// entry for a txID is the transfer's state: BEGIN, PREPARED, CREDITED,
+// COMMITTED or ABORTED.
+class TransferLogEntry {
+private:
+    long long txID;
+    string state;
+    int senderAccountID;
+    int receiverAccountID;
+    double amount;
+
+public:
+    // Column layout of a transfers.log row
+    static constexpr auto Schema() {
+        return MakeSchema(MakeField("txID", &TransferLogEntry::txID),
+                          MakeField("state", &TransferLogEntry::state),
+                          MakeField("senderAccountID", &TransferLogEntry::senderAccountID),
+                          MakeField("receiverAccountID", &TransferLogEntry::receiverAccountID),
+                          MakeField("amount", &TransferLogEntry::amount));
+    }
+
+    // Default constructor
+    TransferLogEntry() : txID(-1), senderAccountID(-1), receiverAccountID(-1), amount(0.0) {}
+
+    // Parameterized constructor
+    TransferLogEntry(long long txID_, const string& state_, int sender, int receiver, double amount_)
+        : txID(txID_), state(state_), senderAccountID(sender), receiverAccountID(receiver), amount(amount_) {}
+
+    // Constructor to create a TransferLogEntry object from a formatted string
+    TransferLogEntry(const string& line) : TransferLogEntry() {
+        if (!ParseRecordText(line, *this)) {
+            throw runtime_error("ERROR: Malformed transfer log record: " + line);
+        }
+    }
+
+    // Convert a TransferLogEntry object to a formatted string
+    string ToString() const {
+        string line;
+        AppendRecordText(*this, line);
+        return line;
+    }
+
+    long long GetTxID() const {
+        return txID;
+    }
+
+    const string& GetState() const {
+        return state;
+    }
+
+    void SetState(const string& state_) {
+        state = state_;
+    }
+
+    int GetSenderAccountID() const {
+        return senderAccountID;
+    }
+
+    int GetReceiverAccountID() const {
+        return receiverAccountID;
+    }
+
+    double GetAmount() const {
+        return amount;
+    }
+};
+
+static_assert(ColumnCount<ShardInfo>() == 4 && HasUniqueNames(ShardInfo::Schema())
+              && HasCodecs(ShardInfo::Schema()), "Invalid ShardInfo schema");
+static_assert(ColumnCount<PendingDebit>() == 4 && HasUniqueNames(PendingDebit::Schema())
+              && HasCodecs(PendingDebit::Schema()), "Invalid PendingDebit schema");
+static_assert(ColumnCount<TransferLogEntry>() == 5 && HasUniqueNames(TransferLogEntry::Schema())
+              && HasCodecs(TransferLogEntry::Schema()), "Invalid TransferLogEntry schema");
+
+// Parse a whole protocol argument with the schema codecs
+template <typename T>
+bool ParseArgument(const string& text, T& value) {
+    const char* pos = text.data();
+    const char* end = pos + text.size();
+    return FieldCodec<T>::ReadText(pos, end, value) && pos == end;
+}
+
+vector<ShardInfo> LoadShards(const string& path) {
+    vector<ShardInfo> shards;
+    for (const string& line : ReadFile(path)) {
+        shards.push_back(ShardInfo(line));
+    }
+    return shards;
+}
+
+#ifndef _WIN32
+
+// Requests and replies are single '\n' terminated lines of space separated
+// words; replies start with OK or ERROR.
+bool ReadSocketLine(int fd, string& line) {
+    line.clear();
+    char buffer[512];
+    while (true) {
+        ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+            return false;
+        }
+        line.append(buffer, received);
+        size_t newline = line.find('\n');
+        if (newline != string::npos) {
+            line.resize(newline);
+            return true;
+        }
+    }
+}
+
+bool WriteSocketLine(int fd, const string& line) {
+    string message = line + "\n";
+    size_t sent = 0;
+    while (sent < message.size()) {
+        ssize_t written = send(fd, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+        if (written <= 0) {
+            return false;
+        }
+        sent += written;
+    }
+    return true;
+}
+
+sockaddr_un UnixAddress(const string& path) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw runtime_error("ERROR: Socket path is too long: " + path);
+    }
+    strcpy(address.sun_path, path.c_str());
+    return address;
+}
+
+// Send one request to a shard and wait for its reply
+string SendShardRequest(const string& socketPath, const string& request) {
+    sockaddr_un address = UnixAddress(socketPath);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw runtime_error("ERROR: Can't create a socket");
+    }
+    string reply;
+    bool ok = connect(fd, (sockaddr*) &address, sizeof(address)) == 0
+              && WriteSocketLine(fd, request) && ReadSocketLine(fd, reply);
+    close(fd);
+    if (!ok) {
+        throw runtime_error("ERROR: Shard at " + socketPath + " is unreachable");
+    }
+    return reply;
+}
+
+// Listening socket for a shard process
+int ListenUnix(const string& socketPath) {
+    sockaddr_un address = UnixAddress(socketPath);
+    unlink(socketPath.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, (sockaddr*) &address, sizeof(address)) != 0 || listen(fd, 64) != 0) {
+        throw runtime_error("ERROR: Can't listen on " + socketPath);
+    }
+    return fd;
+}
+
+// Exclusive flock() on a file for the lifetime of the object, so separate
+// processes can serialize a read-modify-append of the same file
+class FileLock {
+private:
+    int fd;
+
+public:
+    FileLock(const string& path) : fd(open(path.c_str(), O_RDWR | O_CREAT, 0644)) {
+        if (fd < 0 || flock(fd, LOCK_EX) != 0) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            throw runtime_error("ERROR: Can't lock the file " + path);
+        }
+    }
+
+    ~FileLock() {
+        flock(fd, LOCK_UN);
+        close(fd);
+    }
+
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+};
+
+// Sends each operation to the shard owning the account. A transfer between
+// two shards is a two-phase commit driven from transfers.log: BEGIN, PREPARE
+// (the sender shard reserves the debit), CREDIT (the receiver shard, once
+// per txID), then COMMIT (the sender shard applies the debit). A crash
+// anywhere leaves the transfer in doubt until Recover() finishes it.
+class ShardRouter {
+private:
+    vector<ShardInfo> shards;
+    string logPath;
+
+    void Log(const TransferLogEntry& entry) {
+        WriteFile(logPath, { entry.ToString() }, true);
+    }
+
+    static bool IsOk(const string& reply) {
+        return reply.compare(0, 2, "OK") == 0;
+    }
+
+    string TxRequest(const string& op, long long txID, int first, int second, double amount) {
+        string request = op + " " + to_string(txID) + " " + to_string(first) + " " + to_string(second) + " ";
+        FieldCodec<double>::WriteText(request, amount);
+        return request;
+    }
+
+    // Drive an in-doubt transfer to COMMITTED or ABORTED from its last logged state
+    string Resume(TransferLogEntry entry) {
+        const string& sender = ShardFor(entry.GetSenderAccountID()).GetSocketPath();
+        const string& receiver = ShardFor(entry.GetReceiverAccountID()).GetSocketPath();
+        int from = entry.GetSenderAccountID();
+        int to = entry.GetReceiverAccountID();
+        double amount = entry.GetAmount();
+
+        if (entry.GetState() == "BEGIN") {
+            string reply = SendShardRequest(sender, TxRequest("PREPARE", entry.GetTxID(), from, to, amount));
+            if (!IsOk(reply)) {
+                SendShardRequest(sender, TxRequest("ABORT", entry.GetTxID(), from, to, amount));
+                entry.SetState("ABORTED");
+                Log(entry);
+                return reply;
+            }
+            entry.SetState("PREPARED");
+            Log(entry);
+        }
+        if (entry.GetState() == "PREPARED") {
+            string reply = SendShardRequest(receiver, TxRequest("CREDIT", entry.GetTxID(), to, from, amount));
+            if (!IsOk(reply)) {
+                SendShardRequest(sender, TxRequest("ABORT", entry.GetTxID(), from, to, amount));
+                entry.SetState("ABORTED");
+                Log(entry);
+                return reply;
+            }
+            entry.SetState("CREDITED");
+            Log(entry);
+        }
+        if (entry.GetState() == "CREDITED") {
+            string reply = SendShardRequest(sender, TxRequest("COMMIT", entry.GetTxID(), from, to, amount));
+            if (!IsOk(reply)) {
+                return reply; // Stays in doubt; a later Recover() retries the commit
+            }
+            entry.SetState("COMMITTED");
+            Log(entry);
+        }
+        return "OK";
+    }
+
+    // Last logged entry of every transfer
+    map<long long, TransferLogEntry> LatestStates() const {
+        map<long long, TransferLogEntry> latest;
+        try {
+            for (const string& line : ReadFile(logPath)) {
+                TransferLogEntry entry(line);
+                latest[entry.GetTxID()] = entry;
+            }
+        } catch (const runtime_error&) {
+            // No transfers have been logged yet
+        }
+        return latest;
+    }
+
+    // Take the next txID from the counter file next to the log. Only called
+    // under the log's lock. The log is only read when there is no counter
+    // yet; the counter is saved before the ID is used, so an ID is never
+    // handed out twice even if the router stops right after.
+    long long TakeTxID() {
+        string counterPath = logPath + ".next";
+        long long txID = 0;
+        try {
+            vector<string> lines = ReadFile(counterPath);
+            if (!lines.empty()) {
+                txID = stoll(lines[0]);
+            }
+        } catch (const runtime_error&) {
+            // No counter yet
+        }
+        if (txID == 0) {
+            map<long long, TransferLogEntry> latest = LatestStates();
+            txID = latest.empty() ? 1 : latest.rbegin()->first + 1;
+        }
+
+        string temporaryPath = counterPath + ".tmp";
+        WriteFile(temporaryPath, { to_string(txID + 1) }, false);
+        if (rename(temporaryPath.c_str(), counterPath.c_str()) != 0) {
+            throw runtime_error("ERROR: Can't replace the file " + counterPath);
+        }
+        return txID;
+    }
+
+public:
+    ShardRouter(const string& shardsPath, const string& logPath_ = "transfers.log")
+        : shards(LoadShards(shardsPath)), logPath(logPath_) {}
+
+    const ShardInfo& ShardFor(int accountID) const {
+        for (const ShardInfo& shard : shards) {
+            if (shard.Owns(accountID)) {
+                return shard;
+            }
+        }
+        throw runtime_error("ERROR: No shard owns account " + to_string(accountID));
+    }
+
+    // Operations on a single account go straight to its shard
+    string Send(int accountID, const string& request) {
+        return SendShardRequest(ShardFor(accountID).GetSocketPath(), request);
+    }
+
+    string Transfer(int from, int to, double amount) {
+        const ShardInfo& sender = ShardFor(from);
+        const ShardInfo& receiver = ShardFor(to);
+        if (&sender == &receiver) {
+            string request = "TRANSFER " + to_string(from) + " " + to_string(to) + " ";
+            FieldCodec<double>::WriteText(request, amount);
+            return SendShardRequest(sender.GetSocketPath(), request);
+        }
+
+        // Several routers may run at once: the next txID is taken and its
+        // BEGIN appended under one exclusive lock on the log
+        TransferLogEntry entry;
+        {
+            FileLock lock(logPath);
+            entry = TransferLogEntry(TakeTxID(), "BEGIN", from, to, amount);
+            Log(entry);
+        }
+        return Resume(entry);
+    }
+
+    // Finish every transfer whose last logged state isn't final. Returns the
+    // number of transfers still in doubt (e.g. a shard is still down).
+    size_t Recover() {
+        size_t inDoubt = 0;
+        for (const auto& txPair : LatestStates()) {
+            const string& state = txPair.second.GetState();
+            if (state == "COMMITTED" || state == "ABORTED") {
+                continue;
+            }
+            try {
+                if (Resume(txPair.second) == "OK") {
+                    continue;
+                }
+            } catch (const runtime_error& error) {
+                cout << error.what() << "\n";
+            }
+            inDoubt++;
+        }
+        return inDoubt;
+    }
+
+    // Ask every shard to stop
+    void ShutdownAll() {
+        for (const ShardInfo& shard : shards) {
+            try {
+                SendShardRequest(shard.GetSocketPath(), "SHUTDOWN");
+            } catch (const runtime_error&) {
+                // Already down
+            }
+        }
+    }
+};
+
+#endif
+
+class BankSystem {
+private:
+    User currentUser;
+    Account currentAccount;
+    map<string, User> userMap; // username to user object
+    map<int, Account> accountMap; // account id to account object
+    StandingOrderScheduler scheduler;
+    map<long long, PendingDebit> pendingDebits; // Cross-shard debits prepared but not committed
+    map<long long, TransactionHistory> appliedTransfers; // Cross-shard transfer ID to its row in the history
+    set<pair<int, long long>> appliedOrders;    // Standing order occurrences (order ID, due) already in the history
+    FraudRuleEngine fraudRules;
+    HotAccountLedger hotAccounts;
+    SnapshotStore snapshots; // Committed account states for readers
+    int lastAccountID;
+
+    static const size_t kStandingOrderBatchSize = 4096;
+
+public:
+    BankSystem() : currentUser(), currentAccount(), lastAccountID(0) {}
+
+    // Save everything and publish the accounts in `changedAccounts` (the ones
+    // this write touched) to snapshot readers. The maps in memory are what
+    // was saved, so nothing is read back.
+    void UpdateDatabase(vector<int> changedAccounts) {
+        // Hot-account credits must be in the balances before they are saved
+        vector<int> folded = hotAccounts.Fold(accountMap);
+        changedAccounts.insert(changedAccounts.end(), folded.begin(), folded.end());
+
+        // Update user data
+        vector<string> userLines;
+        for (const auto& userPair : userMap) {
+            userLines.push_back(userPair.second.ToString());
+        }
+        WriteFile("users.txt", userLines, false);
+
+        SaveAccounts();
+
+        // Update transaction history data
+        vector<string> historyLines;
+        for (auto& accountPair : accountMap) {
+            vector<string> transactionLines = accountPair.second.GetTransactionHistory();
+            historyLines.insert(historyLines.end(), transactionLines.begin(), transactionLines.end());
+        }
+        WriteFile("history.txt", historyLines, false);
+
+        snapshots.Publish(accountMap, changedAccounts);
+    }
+
+    // Commit a write that only added history rows: the balances are
+    // rewritten, but `newRows` are appended to history.txt instead of
+    // rewriting the whole history
+    void AppendToDatabase(vector<int> changedAccounts, const vector<string>& newRows) {
+        vector<int> folded = hotAccounts.Fold(accountMap);
+        changedAccounts.insert(changedAccounts.end(), folded.begin(), folded.end());
+        SaveAccounts();
+        WriteFile("history.txt", newRows);
+        snapshots.Publish(accountMap, changedAccounts);
+    }
+
+    void SaveAccounts() {
+        vector<string> accountLines;
+        for (const auto& accountPair : accountMap) {
+            accountLines.push_back(accountPair.second.ToString());
+        }
+        WriteFile("accounts.txt", accountLines, false);
+    }
+
+    void LoadDatabase() {
+        userMap.clear();
+        accountMap.clear();
+
+        // Finish an end-of-day run that stopped part-way through its commit
+        EndOfDayJob::Recover("endofday.txt", "history.txt", "accounts.txt");
+
+        // Load user data
+        vector<string> userLines = ReadFile("users.txt");
+        for (const string& userLine : userLines) {
+            User user(userLine);
+            userMap[user.GetUserName()] = user;
+        }
+
+        // Load account data
+        vector<string> accountLines = ReadFile("accounts.txt");
+        for (const string& accountLine : accountLines) {
+            Account account(accountLine);
+            accountMap[account.GetAccountID()] = account;
+            lastAccountID = max(lastAccountID, account.GetAccountID());
+        }
+
+        // Load transaction history data
+        appliedOrders.clear();
+        vector<string> historyLines = ReadFile("history.txt");
+        for (const string& historyLine : historyLines) {
+            TransactionHistory transaction(historyLine);
+            pair<int, long long> occurrence;
+            if (OrderFromMessage(transaction.GetMessage(), occurrence)) {
+                appliedOrders.insert(occurrence);
+            }
+            accountMap[transaction.GetAccountID()].AddTransaction(transaction);
+        }
+
+        // Make the loaded state visible to snapshot readers
+        vector<int> loaded;
+        loaded.reserve(accountMap.size());
+        for (const auto& accountPair : accountMap) {
+            loaded.push_back(accountPair.first);
+        }
+        snapshots.Publish(accountMap, loaded);
+    }
+
+    void Access() {
+        LoadDatabase();
+        scheduler.Load("orders.txt", time(0));
+        RunStandingOrders();
+        int choice = ShowMenu({ "Login", "Sign Up" });
+        if (choice == 1)
+            Login();
+        else
+            SignUp();
+    }
+
+    void Run() {
+        // The interactive menu doesn't go through the router, so it would
+        // bypass the two-phase commit and hand out IDs outside the shard's range
+        if (ifstream("shard.txt").good()) {
+            cout << "This directory holds shard data; use --route to change it.\n";
+            return;
+        }
+        Access();
+
+        while (true) {
+            RunStandingOrders();
+
+            vector<string> menuOptions;
+            menuOptions.push_back("Account Information");
+            menuOptions.push_back("Personal Information");
+            menuOptions.push_back("Edit Personal Information");
+            menuOptions.push_back("Transaction History");
+            menuOptions.push_back("Transfer Money");
+            menuOptions.push_back("Deposit Money");
+            menuOptions.push_back("Withdraw Money");
+            menuOptions.push_back("Export Statement");
+            menuOptions.push_back("Standing Orders");
+            menuOptions.push_back("Log Out");
+
+
+            int choice = ShowMenu(menuOptions);
+
+            switch (choice) {
+                case 1:
+                    PrintAccountInfo();
+                    break;
+                case 2:
+                    currentUser.PrintInfo();
+                    break;
+                case 3:
+                    EditPersonalInfo();
+                    break;
+                case 4:
+                    PrintTransactionHistory();
+                    break;
+                case 5:
+                    TransferMoney();
+                    break;
+                case 6:
+                    DepositMoney();
+                    break;
+                case 7:
+                    WithdrawMoney();
+                    break;
+                case 8:
+                    ExportStatement();
+                    break;
+                case 9:
+                    ManageStandingOrders();
+                    break;
+                case 10:
+                    Logout();
+                    return;
+                default:
+                    break;
+            }
+                vector<string> exitOptions;
+                exitOptions.push_back("Return to Main Menu");
+                exitOptions.push_back("Exit Program");
+
+                int exitChoice = ShowMenu(exitOptions);
+
+                if (exitChoice == 2) {
+                    fraudRules.FlushStats(); // exit() skips the destructors
+                    exit(0);  // Exit the program
+                }
+        }
+    }
+
+    void Login() {
+        while (true) {
+            string userName, password;
+            cout << "\nEnter User Name: ";
+            cin >> userName;
+            cout << "Enter Password: ";
+            cin >> password;
+
+            if (!userMap.count(userName)) {
+                cout << "\nInvalid username or password. Try again.\n";
+                continue;
+            }
+
+            currentUser = userMap[userName];
+
+            if (currentUser.GetPassword() != password) {
+                cout << "\nInvalid username or password. Try again.\n";
+                currentUser = User(); // Reset currentUser to default state
+                currentAccount = Account(); // Reset currentAccount to default state
+                continue;
+            }
+
+            currentAccount = accountMap[currentUser.GetAccountID()];
+            cout << "\n\t->->-> Welcome Back!! <-<-<-\n\n";
+            break;
+        }
+    }
+
+    void SignUp() {
+        string userName;
+        while (true) {
+            cout << "\nEnter User Name: ";
+            cin >> userName;
+            if (userMap.count(userName)) {
+                cout << "\n-> Username already in use. Try again <-\n\n";
+                continue;
+            }
+            break;
+        }
+
+        currentUser = User();
+        currentAccount = Account();
+        lastAccountID++;
+
+        currentUser.ReadData(userName, lastAccountID);
+
+        const double initialBalanceRequirement = 100.0; // Minimum balance requirement
+        cout << "\n\tTo open an account, you need to deposit at least $" << initialBalanceRequirement << endl;
+
+        double initialDeposit;
+        while (true) {
+            cout << "\n\tEnter the initial deposit amount: $";
+            cin >> initialDeposit;
+            if (initialDeposit < initialBalanceRequirement) {
+                cout << "\n\tThe initial deposit amount is less than the required amount. Try again.\n";
+            } else {
+                break;
+            }
+        }
+
+        currentAccount.SetAccountID(lastAccountID);
+        currentAccount.SetBalance(initialDeposit);
+
+        accountMap[currentUser.GetAccountID()] = currentAccount;
+        userMap[userName] = currentUser;
+
+        UpdateDatabase({ currentUser.GetAccountID() });
+
+        cout << "\n\t->->-> Welcome!! <-<-<-\n\n";
+    }
+
+    string GetTime() {
+        return FormatTime(time(0));
+    }
+
+    void EditPersonalInfo() {
+        vector<string> choices;
+        choices.push_back("First Name");
+        choices.push_back("Last Name");
+        choices.push_back("Email");
+        choices.push_back("User Name");
+        choices.push_back("Password");
+
+        int choice = ShowMenu(choices);
+
+        switch (choice) {
+            case 1:
+                ChangeFirstName();
+                break;
+            case 2:
+                ChangeLastName();
+                break;
+            case 3:
+                ChangeEmail();
+                break;
+            case 4:
+                ChangeUserName();
+                break;
+            case 5:
+                ChangePassword();
+                break;
+            default:
+                break;
+        }
+
+        cout << "\nDo any other changes? (Y/N): ";
+        char input;
+        cin >> input;
+        if (input == 'y' || input == 'Y') {
+            EditPersonalInfo();
+        }
+
+        UpdateDatabase({});
+    }
+
+    void ChangeFirstName() {
+        string firstName;
+        cout << "\nEnter your new First Name: ";
+        cin >> firstName;
+        currentUser.ChangeFirstName(firstName);
+        cout << "\n\t->-> Done! <-<-\n";
+
+        userMap[currentUser.GetUserName()].ChangeFirstName(firstName);
+    }
+
+    void ChangeLastName() {
+        string lastName;
+        cout << "\nEnter your Last Name: ";
+        cin >> lastName;
+        currentUser.ChangeLastName(lastName);
+        cout << "\n\t->-> Done! <-<-\n";
+
+        userMap[currentUser.GetUserName()].ChangeLastName(lastName);
+    }
+
+    void ChangeEmail() {
+        string email;
+        cout << "\nEnter your Email: ";
+        cin >> email;
+        currentUser.ChangeEmail(email);
+        cout << "\n\t->-> Done! <-<-\n";
+
+        userMap[currentUser.GetUserName()].ChangeEmail(email);
+    }
+
+    void ChangeUserName() {
+        string newUserName;
+        while (true) {
+            cout << "\nEnter your new User Name: ";
+            cin >> newUserName;
+
+            if (userMap.count(newUserName)) {
+                cout << "\n-> Username already in use. Please choose a different username.\n\n";
+            } else if (currentUser.GetUserName() == newUserName) {
+                cout << "\n-> This is your current username. Please choose a different username.\n\n";
+            } else {
+                break;
+            }
+        }
+
+        scheduler.RenameUser(currentUser.GetUserName(), newUserName);
+        scheduler.Save("orders.txt");
+
+        currentUser.ChangeUserName(newUserName);
+        cout << "\n\t->-> Username updated successfully! <-<-\n";
+
+        userMap[currentUser.GetUserName()] = currentUser;
+    }
+
+    void ChangePassword() {
+        string currentPassword;
+        int remainingAttempts = 3; // Number of password change attempts allowed
+
+        while (remainingAttempts > 0) {
+            cout << "\nEnter your current password: ";
+            cin >> currentPassword;
+
+            if (currentPassword != currentUser.GetPassword()) {
+                cout << "\nIncorrect current password. ";
+                cout << "Remaining attempts: " << remainingAttempts - 1 << endl;
+                remainingAttempts--;
+                continue;
+            }
+            string newPassword;
+            
+            while (true) {
+                cout << "\nEnter your password \n(at least 8 characters with numbers, characters, \nspecial characters, and an uppercase letter): ";
+                cin >> newPassword;
+
+                if (ValidatePassword(newPassword)) {
+                    string confirmPassword;
+                    cout << "Confirm your password: ";
+                    cin >> confirmPassword;
+
+                    if (newPassword == confirmPassword) {
+                        break;
+                    } else {
+                        cout << "Passwords do not match. Please try again." << endl;
+                    }
+                } else {
+                    cout << "Invalid password format. Please try again." << endl;
+                }
+            }
+            currentUser.ChangePassword(newPassword);
+            cout << "\nPassword updated successfully.\n";
+
+            userMap[currentUser.GetUserName()] = currentUser;
+
+            return;
+        }
+
+        cout << "\nExceeded maximum password change attempts. ";
+        cout << "Please try again later.\n";
+    }
+
+    void DepositMoney() {
+        double amount;
+        while (true) {
+            cout << "\nEnter the amount to deposit: $";
+            cin >> amount;
+            if (amount > 1000000.0) {
+                cout << "\n->-> You can't deposit more than a million dollars at a time. Try again <-<-\n";
+                continue;
+            }
+            break;
+        }
+
+        currentAccount.UpdateBalance(amount);
+        string transactionDate = GetTime();
+        TransactionHistory transaction("Deposit", "", amount, transactionDate, currentUser.GetAccountID(), currentAccount.GetBalance());
+        currentAccount.AddTransaction(transaction);
+        accountMap[currentAccount.GetAccountID()] = currentAccount;
+        UpdateDatabase({ currentAccount.GetAccountID() });
+
+        cout << "\n\t->-> $" << amount << " has been added to your account successfully! <-<-\n";
+    }
+
+    void WithdrawMoney() {
+        double amount;
+        while (true) {
+            cout << "\nEnter the amount to withdraw: $";
+            cin >> amount;
+            if (currentAccount.GetBalance() < amount) {
+                cout << "\n->-> The amount you entered is greater than your balance. Try again <-<-\n";
+                continue;
+            }
+            break;
+        }
+
+        long long now = time(0);
+        string declinedBy = VelocityCheck("Withdraw", currentAccount.GetAccountID(), "", amount, now);
+        if (!declinedBy.empty()) {
+            cout << "\n->-> Withdrawal declined: it exceeds the " << declinedBy << " limit <-<-\n";
+            return;
+        }
+
+        currentAccount.UpdateBalance(-amount);
+        fraudRules.Record("Withdraw", currentAccount, "", amount, now);
+        string transactionDate = GetTime();
+        TransactionHistory transaction("Withdraw", "", amount, transactionDate, currentUser.GetAccountID(), currentAccount.GetBalance());
+        currentAccount.AddTransaction(transaction);
+        accountMap[currentAccount.GetAccountID()] = currentAccount;
+        UpdateDatabase({ currentAccount.GetAccountID() });
+
+        cout << "\n\t->-> $" << amount << " has been withdrawn successfully! <-<-\n";
+    }
+
+    // Velocity rules shared by every withdrawal and transfer path. Returns
+    // the name of the rule that declines the operation, or "" if it passes.
+    string VelocityCheck(const string& operation, int accountID, const string& receiver, double amount, long long now) {
+        uint32_t pendingTransfers = 0;
+        for (const auto& pendingPair : pendingDebits) {
+            pendingTransfers += pendingPair.second.GetAccountID() == accountID;
+        }
+        string declinedBy;
+        if (fraudRules.Allow(operation, accountMap[accountID], receiver, amount, now, declinedBy,
+                             pendingTransfers, ReservedAmount(accountID))) {
+            return "";
+        }
+        return declinedBy;
+    }
+
+    // Balance check shared by interactive and scheduled transfers
+    bool HasFunds(int accountID, double amount) {
+        return accountMap.count(accountID) && AvailableBalance(accountID) >= amount;
+    }
+
+    // Balance including hot-account credits not folded yet, less prepared debits
+    double AvailableBalance(int accountID) {
+        return accountMap[accountID].GetBalance() + hotAccounts.Pending(accountID) - ReservedAmount(accountID);
+    }
+
+    // Every incoming transfer goes through here so hot accounts don't
+    // serialize on their balance; returns the receiver's balance after it
+    double CreditAccount(int accountID, double amount) {
+        Account& receiver = accountMap[accountID];
+        if (!hotAccounts.Credit(accountID, amount, time(0))) {
+            receiver.UpdateBalance(amount);
+        }
+        return receiver.GetBalance() + hotAccounts.Pending(accountID);
+    }
+
+    // Money held back by prepared cross-shard debits
+    double ReservedAmount(int accountID) {
+        double reserved = 0.0;
+        for (const auto& pendingPair : pendingDebits) {
+            if (pendingPair.second.GetAccountID() == accountID) {
+                reserved += pendingPair.second.GetAmount();
+            }
+        }
+        return reserved;
+    }
+
+    // Receiver check shared by interactive and scheduled transfers
+    bool ReceiverExists(const string& receiver) {
+        return userMap.count(receiver) > 0;
+    }
+
+    // Move the money and record it in both histories; the caller has already
+    // run HasFunds() and ReceiverExists(). `tag` is appended to both messages.
+    void ApplyTransfer(int senderAccountID, const string& senderUserName, const string& receiver,
+                       double amount, const string& transactionDate, const string& tag = "") {
+        Account& sender = accountMap[senderAccountID];
+        sender.UpdateBalance(-amount);
+        string transactionMessage = " to (" + receiver + ") " + tag;
+        TransactionHistory senderTransaction("Transfer", transactionMessage, amount, transactionDate, senderAccountID, sender.GetBalance());
+        sender.AddTransaction(senderTransaction);
+
+        int receiverAccountID = userMap[receiver].GetAccountID();
+        double receiverBalance = CreditAccount(receiverAccountID, amount);
+        string receiverTransactionMessage = " from (" + senderUserName + ") " + tag;
+        TransactionHistory receiverTransaction("Receive", receiverTransactionMessage, amount, transactionDate, receiverAccountID, receiverBalance);
+        accountMap[receiverAccountID].AddTransaction(receiverTransaction);
+    }
+
+    void TransferMoney() {
+        double amount;
+        while (true) {
+            cout << "\nEnter the amount to transfer: $";
+            cin >> amount;
+            if (!HasFunds(currentAccount.GetAccountID(), amount)) {
+                cout << "\n->-> The amount you entered is greater than your balance. Try again <-<-\n";
+                continue;
+            }
+            break;
+        }
+
+        string receiver;
+
+        while (true) {
+            cout << "\nTo user: ";
+            cin >> receiver;
+            if (!ReceiverExists(receiver)) {
+                cout << "\n->-> User does not exist. Try again\n";
+                continue;
+            }
+            break;
+        }
+
+        long long now = time(0);
+        string declinedBy = VelocityCheck("Transfer", currentAccount.GetAccountID(), receiver, amount, now);
+        if (!declinedBy.empty()) {
+            cout << "\n->-> Transfer declined: it exceeds the " << declinedBy << " limit <-<-\n";
+            return;
+        }
+
+        fraudRules.Record("Transfer", accountMap[currentAccount.GetAccountID()], receiver, amount, now);
+        ApplyTransfer(currentAccount.GetAccountID(), currentUser.GetUserName(), receiver, amount, GetTime());
+        UpdateDatabase({ currentAccount.GetAccountID(), userMap[receiver].GetAccountID() });
+        currentAccount = accountMap[currentUser.GetAccountID()];
+
+        cout << "\n\t->$" << amount << " has been sent to " << receiver << " successfully! <-\n";
+    }
+
+    // Standing order payments carry the order ID and due time, so an
+    // occurrence that reached the history before a crash isn't paid again
+    static string OrderTag(int orderID, long long due) {
+        return "[order " + to_string(orderID) + " due " + to_string(due) + "] ";
+    }
+
+    static bool OrderFromMessage(const string& message, pair<int, long long>& occurrence) {
+        size_t pos = message.find("[order ");
+        return pos != string::npos
+               && sscanf(message.c_str() + pos, "[order %d due %lld]", &occurrence.first, &occurrence.second) == 2;
+    }
+
+    // Execute every standing order that has come due. Each occurrence goes
+    // through the same checks as TransferMoney(); one that fails a check is
+    // skipped. The whole run is committed at the end with one append to
+    // history.txt and one save of the schedule, so a long catch-up costs the
+    // same per payment as a short one. The history is saved before the
+    // schedule: if the program stops in between, the replayed occurrences
+    // are found by their tags and skipped.
+    void RunStandingOrders() {
+        size_t executed = 0, skipped = 0;
+        map<int, size_t> savedRows; // History length of each changed account before the run
+        size_t due = scheduler.RunDue(time(0), kStandingOrderBatchSize, [&](const vector<DueOrder>& batch) {
+            for (const DueOrder& dueOrder : batch) {
+                const StandingOrder& order = *dueOrder.order;
+                if (appliedOrders.count({ order.GetOrderID(), dueOrder.due })) {
+                    continue; // Already paid before the last restart
+                }
+                // Velocity rules see the order at its due time, so a catch-up
+                // run decides the same way an on-time run would have
+                if (!HasFunds(order.GetSenderAccountID(), order.GetAmount())
+                    || !ReceiverExists(order.GetReceiverUserName())
+                    || !VelocityCheck("Transfer", order.GetSenderAccountID(), order.GetReceiverUserName(),
+                                      order.GetAmount(), dueOrder.due).empty()) {
+                    skipped++;
+                    continue;
+                }
+                for (int accountID : { order.GetSenderAccountID(), userMap[order.GetReceiverUserName()].GetAccountID() }) {
+                    savedRows.emplace(accountID, accountMap[accountID].GetTransactions().size());
+                }
+                fraudRules.Record("Transfer", accountMap[order.GetSenderAccountID()], order.GetReceiverUserName(),
+                                  order.GetAmount(), dueOrder.due);
+                ApplyTransfer(order.GetSenderAccountID(), order.GetSenderUserName(), order.GetReceiverUserName(),
+                              order.GetAmount(), FormatTime((time_t) dueOrder.due),
+                              OrderTag(order.GetOrderID(), dueOrder.due));
+                appliedOrders.insert({ order.GetOrderID(), dueOrder.due });
+                executed++;
+            }
+        });
+
+        if (due == 0) {
+            return;
+        }
+        vector<int> changed;
+        vector<string> newRows;
+        for (const auto& savedPair : savedRows) {
+            const auto& rows = accountMap[savedPair.first].GetTransactions();
+            for (size_t i = savedPair.second; i < rows.size(); i++) {
+                newRows.push_back(rows[i]->ToString());
+            }
+            changed.push_back(savedPair.first);
+        }
+        AppendToDatabase(changed, newRows);
+        scheduler.Save("orders.txt");
+        if (currentAccount.GetAccountID() != -1) {
+            currentAccount = accountMap[currentAccount.GetAccountID()];
+        }
+        cout << "\n\t->-> Standing orders: " << executed << " executed, " << skipped << " skipped <-<-\n";
+    }
+
+    void ManageStandingOrders() {
+        int choice = ShowMenu({ "Schedule Transfer", "View Standing Orders", "Cancel Standing Order" });
+
+        switch (choice) {
+            case 1:
+                ScheduleTransfer();
+                break;
+            case 2:
+                ViewStandingOrders();
+                break;
+            case 3:
+                CancelStandingOrder();
+                break;
+            default:
+                break;
+        }
+    }
+
+    void ScheduleTransfer() {
+        double amount;
+        while (true) {
+            cout << "\nEnter the amount to transfer: $";
+            cin >> amount;
+            if (amount <= 0) {
+                cout << "\n->-> The amount must be greater than zero. Try again <-<-\n";
+                continue;
+            }
+            break;
+        }
+
+        string receiver;
+        while (true) {
+            cout << "\nTo user: ";
+            cin >> receiver;
+            if (!ReceiverExists(receiver)) {
+                cout << "\n->-> User does not exist. Try again\n";
+                continue;
+            }
+            break;
+        }
+
+        time_t firstDue;
+        while (true) {
+            string day;
+            cout << "\nFirst payment date (YYYY-MM-DD): ";
+            cin >> day;
+            firstDue = DayStart(day);
+            if (firstDue < 0) {
+                cout << "\n->-> Invalid date. Try again <-<-\n";
+                continue;
+            }
+            if (firstDue < DayStart(time(0))) {
+                cout << "\n->-> The first payment can't be in the past. Try again <-<-\n";
+                continue;
+            }
+            break;
+        }
+
+        cout << "\nRepeat:";
+        int period = ShowMenu({ "Once", "Daily", "Weekly", "Monthly" }) - 1;
+
+        StandingOrder order(currentAccount.GetAccountID(), currentUser.GetUserName(), receiver, amount, firstDue, period);
+        int orderID = scheduler.Add(order);
+        scheduler.Save("orders.txt");
+
+        cout << "\n\t->-> Standing order #" << orderID << " has been scheduled! <-<-\n";
+        RunStandingOrders(); // In case the first payment is already due
+    }
+
+    void ViewStandingOrders() {
+        vector<const StandingOrder*> orders = scheduler.OrdersFor(currentAccount.GetAccountID());
+        if (orders.empty()) {
+            cout << "\n\t->-> You have no standing orders! <-<-\n";
+            return;
+        }
+        cout << "\n\t->-> Standing Orders <-<-\n";
+        for (const StandingOrder* order : orders) {
+            order->Print();
+        }
+    }
+
+    void CancelStandingOrder() {
+        int orderID;
+        cout << "\nEnter the order number to cancel: ";
+        cin >> orderID;
+        if (!scheduler.Cancel(orderID, currentAccount.GetAccountID())) {
+            cout << "\n->-> No such standing order <-<-\n";
+            return;
+        }
+        scheduler.Save("orders.txt");
+        cout << "\n\t->-> Standing order #" << orderID << " has been cancelled <-<-\n";
+    }
+
+    // Reports read committed state from a snapshot so they never hold up a commit
+    void PrintAccountInfo() {
+        Snapshot snapshot(snapshots);
+        const AccountVersion* account = snapshot.Find(currentAccount.GetAccountID());
+        if (account == nullptr) {
+            currentAccount.PrintInfo();
+            return;
+        }
+        Account::PrintInfo(account->accountID, account->balance);
+    }
+
+    void PrintTransactionHistory() {
+        Snapshot snapshot(snapshots);
+        const AccountVersion* account = snapshot.Find(currentAccount.GetAccountID());
+        if (account == nullptr || Snapshot::TransactionCount(*account) == 0) {
+            cout << "\n\t->-> Transaction history is empty! <-<-\n";
+            return;
+        }
+        cout << "\n\t->-> Transaction History <-<-\n";
+
+        Snapshot::ForEachTransaction(*account, [](const TransactionHistory& transaction) {
+            transaction.Print();
+        });
+    }
+
+    void ExportStatement() {
+        int choice = ShowMenu({ "CSV", "JSON", "Fixed Width" });
+        StatementFormat format = choice == 1 ? StatementFormat::CSV
+                               : choice == 2 ? StatementFormat::JSON
+                                             : StatementFormat::FixedWidth;
+
+        string fromDay, toDay;
+        cout << "\nFilter by date range? (Y/N): ";
+        char input;
+        cin >> input;
+        if (input == 'y' || input == 'Y') {
+            cout << "From (YYYY-MM-DD): ";
+            cin >> fromDay;
+            cout << "To (YYYY-MM-DD): ";
+            cin >> toDay;
+        }
+
+        try {
+            StatementExporter exporter(format, fromDay, toDay);
+            string path = "statement_" + to_string(currentAccount.GetAccountID()) + exporter.Extension();
+            Snapshot snapshot(snapshots);
+            const AccountVersion* account = snapshot.Find(currentAccount.GetAccountID());
+            size_t rows = account ? exporter.Export(*account, path) : exporter.Export(currentAccount, path);
+            cout << "\n\t->-> " << rows << " transactions written to " << path << " <-<-\n";
+        } catch (const runtime_error& error) {
+            cout << "\n->-> " << error.what() << " <-<-\n";
+        }
+    }
+
+    // Write statements for every account without logging in
+    void ExportAllStatements(StatementFormat format, const string& directory,
+                             const string& fromDay, const string& toDay) {
+        LoadDatabase();
+        StatementExporter exporter(format, fromDay, toDay);
+        Snapshot snapshot(snapshots);
+        size_t rows = exporter.ExportAll(snapshot, directory);
+        cout << rows << " transactions from " << snapshot.Accounts().size() << " accounts written to " << directory << "\n";
+    }
+
+    // Cross-shard history rows carry their transfer ID so a repeated CREDIT
+    // or COMMIT after a crash is recognised and not applied twice
+    static string TxTag(long long txID) {
+        return "[tx " + to_string(txID) + "] ";
+    }
+
+    static long long TxIDFromMessage(const string& message) {
+        size_t pos = message.find("[tx ");
+        long long txID = -1;
+        if (pos != string::npos) {
+            string_view rest = string_view(message).substr(pos + 4);
+            from_chars(rest.data(), rest.data() + rest.size(), txID);
+        }
+        return txID;
+    }
+
+    // Restore prepared debits and the set of applied transfers after a restart
+    void LoadShardState() {
+        appliedTransfers.clear();
+        for (const auto& accountPair : accountMap) {
+            for (const auto& transaction : accountPair.second.GetTransactions()) {
+                long long txID = TxIDFromMessage(transaction->GetMessage());
+                if (txID >= 0) {
+                    appliedTransfers[txID] = *transaction;
+                }
+            }
+        }
+
+        pendingDebits.clear();
+        try {
+            for (const string& line : ReadFile("pending.txt")) {
+                PendingDebit debit(line);
+                // A commit that reached the history but not pending.txt is done
+                if (!appliedTransfers.count(debit.GetTxID())) {
+                    pendingDebits[debit.GetTxID()] = debit;
+                }
+            }
+        } catch (const runtime_error&) {
+            // Nothing has been prepared yet
+        }
+    }
+
+    // Replace pending.txt in one rename so a crash never leaves half a file
+    void SavePendingDebits() {
+        vector<string> lines;
+        for (const auto& pendingPair : pendingDebits) {
+            lines.push_back(pendingPair.second.ToString());
+        }
+        WriteFile("pending.txt.tmp", lines, false);
+        if (rename("pending.txt.tmp", "pending.txt") != 0) {
+            throw runtime_error("ERROR: Can't replace the file pending.txt");
+        }
+    }
+
+    // A repeated PREPARE, CREDIT, COMMIT or ABORT must describe the transfer
+    // already recorded under its txID; anything else is a reused ID
+    static bool SameTransfer(const PendingDebit& debit, int account, int other, double amount) {
+        return debit.GetAccountID() == account && debit.GetReceiverAccountID() == other && debit.GetAmount() == amount;
+    }
+
+    static bool SameTransfer(const TransactionHistory& row, const string& type, int account, int other, double amount) {
+        return row.GetType() == type && row.GetAccountID() == account && row.GetAmount() == amount
+               && row.GetMessage().find("(#" + to_string(other) + ")") != string::npos;
+    }
+
+    static string Ok(double balance) {
+        string reply = "OK ";
+        FieldCodec<double>::WriteText(reply, balance);
+        return reply;
+    }
+
+    // Execute one router request against this shard's accounts:
+    //   BALANCE <account>
+    //   DEPOSIT <account> <amount>
+    //   WITHDRAW <account> <amount>
+    //   TRANSFER <from> <to> <amount>            both accounts on this shard
+    //   PREPARE <tx> <from> <to> <amount>        reserve a cross-shard debit
+    //   CREDIT <tx> <to> <from> <amount>         apply a cross-shard credit
+    //   COMMIT <tx> <from> <to> <amount>         apply a prepared debit
+    //   ABORT <tx> <from> <to> <amount>          release a prepared debit
+    string HandleShardRequest(const string& request) {
+        vector<string> args = SplitString(request, " ");
+        const string& op = args[0];
+        int account = -1, other = -1;
+        long long txID = -1;
+        double amount = 0.0;
+
+        if (op == "BALANCE" && args.size() == 2 && ParseArgument(args[1], account)) {
+            if (!accountMap.count(account)) {
+                return "ERROR Unknown account";
+            }
+            return Ok(AvailableBalance(account));
+        }
+
+        if ((op == "DEPOSIT" || op == "WITHDRAW") && args.size() == 3
+            && ParseArgument(args[1], account) && ParseArgument(args[2], amount) && amount > 0) {
+            if (!accountMap.count(account)) {
+                return "ERROR Unknown account";
+            }
+            if (op == "WITHDRAW" && !HasFunds(account, amount)) {
+                return "ERROR Insufficient funds";
+            }
+            long long now = time(0);
+            if (op == "WITHDRAW") {
+                string declinedBy = VelocityCheck("Withdraw", account, "", amount, now);
+                if (!declinedBy.empty()) {
+                    return "ERROR Declined by " + declinedBy;
+                }
+                fraudRules.Record("Withdraw", accountMap[account], "", amount, now);
+            }
+            Account& target = accountMap[account];
+            target.UpdateBalance(op == "DEPOSIT" ? amount : -amount);
+            target.AddTransaction(TransactionHistory(op == "DEPOSIT" ? "Deposit" : "Withdraw", "", amount, GetTime(), account, target.GetBalance()));
+            UpdateDatabase({ account });
+            return Ok(accountMap[account].GetBalance());
+        }
+
+        if (op == "TRANSFER" && args.size() == 4 && ParseArgument(args[1], account)
+            && ParseArgument(args[2], other) && ParseArgument(args[3], amount) && amount > 0) {
+            if (!accountMap.count(account) || !accountMap.count(other)) {
+                return "ERROR Unknown account";
+            }
+            if (!HasFunds(account, amount)) {
+                return "ERROR Insufficient funds";
+            }
+            long long now = time(0);
+            string declinedBy = VelocityCheck("Transfer", account, "#" + to_string(other), amount, now);
+            if (!declinedBy.empty()) {
+                return "ERROR Declined by " + declinedBy;
+            }
+            fraudRules.Record("Transfer", accountMap[account], "#" + to_string(other), amount, now);
+            string transactionDate = GetTime();
+            Account& sender = accountMap[account];
+            sender.UpdateBalance(-amount);
+            sender.AddTransaction(TransactionHistory("Transfer", " to (#" + to_string(other) + ") ", amount, transactionDate, account, sender.GetBalance()));
+            double receiverBalance = CreditAccount(other, amount);
+            accountMap[other].AddTransaction(TransactionHistory("Receive", " from (#" + to_string(account) + ") ", amount, transactionDate, other, receiverBalance));
+            UpdateDatabase({ account, other });
+            return Ok(accountMap[account].GetBalance());
+        }
+
+        if (args.size() != 5 || !ParseArgument(args[1], txID) || !ParseArgument(args[2], account)
+            || !ParseArgument(args[3], other) || !ParseArgument(args[4], amount) || amount <= 0) {
+            return "ERROR Bad request";
+        }
+
+        auto pending = pendingDebits.find(txID);
+        auto applied = appliedTransfers.find(txID);
+        bool prepared = pending != pendingDebits.end();
+        bool committed = applied != appliedTransfers.end();
+
+        if (op == "PREPARE") {
+            if (prepared || committed) {
+                // Repeated after a crash
+                return (prepared ? SameTransfer(pending->second, account, other, amount)
+                                 : SameTransfer(applied->second, "Transfer", account, other, amount))
+                           ? "OK" : "ERROR Transfer ID reused";
+            }
+            if (!accountMap.count(account)) {
+                return "ERROR Unknown account";
+            }
+            if (!HasFunds(account, amount)) {
+                return "ERROR Insufficient funds";
+            }
+            long long now = time(0);
+            string declinedBy = VelocityCheck("Transfer", account, "#" + to_string(other), amount, now);
+            if (!declinedBy.empty()) {
+                return "ERROR Declined by " + declinedBy;
+            }
+            // Recorded in the velocity windows on COMMIT, so an aborted transfer
+            // isn't; until then VelocityCheck() counts it as pending
+            pendingDebits[txID] = PendingDebit(txID, account, other, amount);
+            SavePendingDebits();
+            return "OK";
+        }
+
+        if (op == "CREDIT") {
+            if (committed) {
+                return SameTransfer(applied->second, "Receive", account, other, amount) ? "OK" : "ERROR Transfer ID reused";
+            }
+            if (!accountMap.count(account)) {
+                return "ERROR Unknown account";
+            }
+            double receiverBalance = CreditAccount(account, amount);
+            accountMap[account].AddTransaction(TransactionHistory("Receive", " from (#" + to_string(other) + ") " + TxTag(txID), amount, GetTime(), account, receiverBalance));
+            appliedTransfers[txID] = *accountMap[account].GetTransactions().back();
+            UpdateDatabase({ account });
+            return "OK";
+        }
+
+        if (op == "COMMIT") {
+            if (!prepared) {
+                if (!committed) {
+                    return "ERROR Transfer was not prepared";
+                }
+                return SameTransfer(applied->second, "Transfer", account, other, amount) ? "OK" : "ERROR Transfer ID reused";
+            }
+            const PendingDebit& debit = pending->second;
+            if (!SameTransfer(debit, account, other, amount)) {
+                return "ERROR Transfer ID reused";
+            }
+            Account& sender = accountMap[debit.GetAccountID()];
+            fraudRules.Record("Transfer", sender, "#" + to_string(other), amount, time(0));
+            sender.UpdateBalance(-debit.GetAmount());
+            sender.AddTransaction(TransactionHistory("Transfer", " to (#" + to_string(debit.GetReceiverAccountID()) + ") " + TxTag(txID),
+                                                     debit.GetAmount(), GetTime(), debit.GetAccountID(), sender.GetBalance()));
+            appliedTransfers[txID] = *sender.GetTransactions().back();
+            UpdateDatabase({ debit.GetAccountID() });
+            pendingDebits.erase(txID);
+            SavePendingDebits();
+            return "OK";
+        }
+
+        if (op == "ABORT") {
+            if (committed) {
+                return "ERROR Transfer already committed";
+            }
+            if (prepared) {
+                if (!SameTransfer(pending->second, account, other, amount)) {
+                    return "ERROR Transfer ID reused";
+                }
+                pendingDebits.erase(pending);
+                SavePendingDebits();
+            }
+            return "OK";
+        }
+
+        return "ERROR Bad request";
+    }
+
+#ifndef _WIN32
+    // Run as shard `index` of shards.txt: serve router requests one at a
+    // time from the shard's socket, with the shard's data directory as the
+    // working directory
+    void ServeShard(const string& shardsPath, int index) {
+        vector<ShardInfo> shards = LoadShards(shardsPath);
+        if (index < 0 || index >= (int) shards.size()) {
+            throw runtime_error("ERROR: No such shard");
+        }
+        string socketPath = shards[index].GetSocketPath();
+        if (!socketPath.empty() && socketPath[0] != '/') {
+            char directory[4096];
+            if (getcwd(directory, sizeof(directory))) {
+                socketPath = string(directory) + "/" + socketPath;
+            }
+        }
+
+        int listener = ListenUnix(socketPath);
+        if (chdir(shards[index].GetDataDirectory().c_str()) != 0) {
+            throw runtime_error("ERROR: Can't open the directory " + shards[index].GetDataDirectory());
+        }
+        LoadDatabase();
+        LoadShardState();
+
+        while (true) {
+            int client = accept(listener, nullptr, nullptr);
+            if (client < 0) {
+                continue;
+            }
+            string request;
+            if (ReadSocketLine(client, request)) {
+                bool shutdown = request == "SHUTDOWN";
+                string reply;
+                try {
+                    reply = shutdown ? "OK" : HandleShardRequest(request);
+                } catch (const runtime_error& error) {
+                    reply = string("ERROR ") + error.what();
+                }
+                WriteSocketLine(client, reply);
+                if (shutdown) {
+                    close(client);
+                    break;
+                }
+            }
+            close(client);
+        }
+        close(listener);
+        unlink(socketPath.c_str());
+    }
+
+    // Partition users.txt, accounts.txt and history.txt into each shard's data directory
+    void SplitIntoShards(const string& shardsPath) {
+        LoadDatabase();
+        vector<string> ruleLines;
+        try {
+            ruleLines = ReadFile("rules.txt");
+        } catch (const runtime_error&) {
+            // No velocity limits to copy
+        }
+        for (const ShardInfo& shard : LoadShards(shardsPath)) {
+            const string& directory = shard.GetDataDirectory();
+            mkdir(directory.c_str(), 0755);
+
+            vector<string> userLines, accountLines, historyLines;
+            for (const auto& userPair : userMap) {
+                if (shard.Owns(userPair.second.GetAccID())) {
+                    userLines.push_back(userPair.second.ToString());
+                }
+            }
+            for (auto& accountPair : accountMap) {
+                if (shard.Owns(accountPair.first)) {
+                    accountLines.push_back(accountPair.second.ToString());
+                    vector<string> transactionLines = accountPair.second.GetTransactionHistory();
+                    historyLines.insert(historyLines.end(), transactionLines.begin(), transactionLines.end());
+                }
+            }
+            WriteFile(directory + "/users.txt", userLines, false);
+            WriteFile(directory + "/accounts.txt", accountLines, false);
+            WriteFile(directory + "/history.txt", historyLines, false);
+            // Each shard reads its velocity limits from its own directory
+            WriteFile(directory + "/rules.txt", ruleLines, false);
+            // Marks the directory as shard data, which only its shard process may change
+            WriteFile(directory + "/shard.txt", { shard.ToString() }, false);
+        }
+    }
+#endif
+
+    // Nightly interest and fee postings for every account, using rates.txt.
+    // Refuses to post the same business day twice.
+    void RunEndOfDay() {
+        LoadDatabase();
+        EndOfDayJob job = EndOfDayJob::FromFile("rates.txt");
+        char businessDay[11];
+        tm today = LocalTime(time(0));
+        strftime(businessDay, sizeof(businessDay), "%Y-%m-%d", &today);
+        EndOfDayJob::Summary summary = job.Run(accountMap, businessDay, GetTime(), "endofday.txt", "history.txt", "accounts.txt");
+        cout << "End of day: " << summary.accounts << " accounts, "
+             << summary.interestPostings << " interest postings ($" << summary.totalInterest << "), "
+             << summary.feePostings << " fee postings ($" << summary.totalFees << ")\n";
+    }
+
+    void Logout() {
+        currentUser = User();
+        currentAccount = Account();
+        cout << "\n\t->->-> You have been successfully logged out. <-<-<-\n\n";
+    }
+
+};
+
+
+int main(int argc, char* argv[]) {
+    BankSystem system;
+
+    // Bulk statement export: BankSystem --export-statements <csv|json|fixed> <directory> [from] [to]
+    if (argc >= 4 && string(argv[1]) == "--export-statements") {
+        string format = argv[2];
+        if (format != "csv" && format != "json" && format != "fixed") {
+            cerr << "Usage: " << argv[0] << " --export-statements <csv|json|fixed> <directory> [from YYYY-MM-DD] [to YYYY-MM-DD]\n";
+            return 2;
+        }
+        StatementFormat statementFormat = format == "json" ? StatementFormat::JSON
+                                        : format == "fixed" ? StatementFormat::FixedWidth
+                                                            : StatementFormat::CSV;
+        try {
+            system.ExportAllStatements(statementFormat, argv[3], argc > 4 ? argv[4] : "", argc > 5 ? argv[5] : "");
+        } catch (const runtime_error& error) {
+            cerr << error.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+#ifndef _WIN32
+    // Sharding: BankSystem --split-shards <shards.txt>
+    //           BankSystem --shard <shards.txt> <index>
+    //           BankSystem --route <shards.txt> <balance|deposit|withdraw|transfer|recover|shutdown> [args]
+    if (argc >= 3 && string(argv[1]) == "--split-shards") {
+        system.SplitIntoShards(argv[2]);
+        return 0;
+    }
+    if (argc >= 4 && string(argv[1]) == "--shard") {
+        system.ServeShard(argv[2], ToInt(argv[3]));
+        return 0;
+    }
+    if (argc >= 4 && string(argv[1]) == "--route") {
+        string reply = "ERROR Bad command";
+        try {
+            ShardRouter router(argv[2]);
+            string command = argv[3];
+            vector<string> args(argv + 4, argv + argc);
+            int account = -1, other = -1;
+            double amount = 0.0;
+            if (command == "balance" && args.size() == 1 && ParseArgument(args[0], account)) {
+                reply = router.Send(account, "BALANCE " + args[0]);
+            } else if ((command == "deposit" || command == "withdraw") && args.size() == 2 && ParseArgument(args[0], account)) {
+                reply = router.Send(account, (command == "deposit" ? "DEPOSIT " : "WITHDRAW ") + args[0] + " " + args[1]);
+            } else if (command == "transfer" && args.size() == 3 && ParseArgument(args[0], account)
+                       && ParseArgument(args[1], other) && ParseArgument(args[2], amount)) {
+                reply = router.Transfer(account, other, amount);
+            } else if (command == "recover") {
+                reply = "OK " + to_string(router.Recover()) + " in doubt";
+            } else if (command == "shutdown") {
+                router.ShutdownAll();
+                reply = "OK";
+            }
+        } catch (const runtime_error& error) {
+            reply = error.what();
+        }
+        cout << reply << "\n";
+        return reply.compare(0, 2, "OK") == 0 ? 0 : 1;
+    }
+#endif
+
+    // Nightly batch: BankSystem --end-of-day
+    if (argc >= 2 && string(argv[1]) == "--end-of-day") {
+        try {
+            system.RunEndOfDay();
+        } catch (const runtime_error& error) {
+            cerr << error.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    system.Run();
+    return 0;
+}
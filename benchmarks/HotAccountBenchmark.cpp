@@ -0,0 +1,78 @@
+// Credit throughput for hot accounts as the number of threads grows.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -pthread benchmarks/HotAccountBenchmark.cpp -o HotAccountBenchmark && ./HotAccountBenchmark
+//
+// Compares HotAccountLedger's per-core slots against a single shared atomic
+// and a mutex-protected balance for credits to one account, and measures
+// credits to many ordinary (not hot) accounts, which go through the striped
+// detection counters. Scaling only shows on a machine with several cores.
+
+#define main BankSystemMain
+#include "../BankSystem.cpp"
+#undef main
+
+// Millions of operations per second when `threads` threads split `total` calls of body(thread)
+template <typename Body>
+double MillionsPerSecond(int threads, long long total, Body body) {
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            for (long long i = 0; i < total / threads; i++) {
+                body(t, i);
+            }
+        });
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+    return total / chrono::duration<double>(chrono::steady_clock::now() - start).count() / 1e6;
+}
+
+int main() {
+    const long long credits = 20000000;
+    const int hotAccountID = 1003003;
+    unsigned cores = max(1u, thread::hardware_concurrency());
+    cout << "Hardware threads: " << cores << "\n";
+    cout << "threads  ledger M/s  one atomic M/s  mutex M/s  ordinary accounts M/s\n";
+
+    for (int threads = 1; threads <= (int) max(8u, cores); threads *= 2) {
+        HotAccountLedger ledger(1, 60);
+        ledger.Credit(hotAccountID, 0.0, 0); // Promote it straight away
+
+        atomic<double> sharedBalance{0.0};
+        mutex balanceMutex;
+        double lockedBalance = 0.0;
+
+        double sharded = MillionsPerSecond(threads, credits, [&](int, long long) {
+            ledger.Credit(hotAccountID, 1.0, 0);
+        });
+        double single = MillionsPerSecond(threads, credits, [&](int, long long) {
+            double current = sharedBalance.load(memory_order_relaxed);
+            while (!sharedBalance.compare_exchange_weak(current, current + 1.0, memory_order_relaxed)) {
+            }
+        });
+        double locked = MillionsPerSecond(threads, credits, [&](int, long long) {
+            lock_guard<mutex> lock(balanceMutex);
+            lockedBalance += 1.0;
+        });
+
+        // 50000 accounts split between the threads, none of which become hot
+        HotAccountLedger ordinaryLedger(1000000, 60);
+        double ordinary = MillionsPerSecond(threads, credits / 10, [&](int thread, long long i) {
+            ordinaryLedger.Credit(thread * 100000 + (int) (i % (50000 / threads)), 1.0, 1000000 + i / 1000000);
+        });
+
+        map<int, Account> accounts;
+        accounts[hotAccountID] = Account(to_string(hotAccountID) + ",0");
+        ledger.Fold(accounts);
+        if (accounts[hotAccountID].GetBalance() != (double) (credits / threads * threads)) {
+            cout << "FAIL: folded " << accounts[hotAccountID].GetBalance() << "\n";
+            return 1;
+        }
+
+        printf("%7d  %10.1f  %14.1f  %9.1f  %21.1f\n", threads, sharded, single, locked, ordinary);
+    }
+    return 0;
+}
@@ -0,0 +1,151 @@
+// Round-trip check and benchmark for the schema-generated record codecs.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -pthread benchmarks/RecordBenchmark.cpp -o RecordBenchmark && ./RecordBenchmark
+//
+// Exits with a non-zero status if any record fails to round-trip.
+
+#define main BankSystemMain
+#include "../BankSystem.cpp"
+#undef main
+
+// The history row parser and serializer as they were before the schemas
+class LegacyTransactionHistory {
+private:
+    string type;
+    string date;
+    string message;
+    double balance;
+    double amount;
+    int accID;
+
+public:
+    LegacyTransactionHistory(string line) {
+        vector<string> content = SplitString(line);
+        accID = ToInt(content[0]);
+        type = content[1];
+        amount = ToDouble(content[2]);
+        message = content[3];
+        balance = ToDouble(content[4]);
+        date = content[5];
+    }
+
+    string ToString() {
+        ostringstream oss;
+        oss << accID << "," << type << "," << amount << "," << message << "," << balance << "," << date;
+        return oss.str();
+    }
+};
+
+int failures = 0;
+
+void Check(bool ok, const string& what) {
+    if (!ok) {
+        cout << "FAIL: " << what << "\n";
+        failures++;
+    }
+}
+
+// Text and binary encodings must both reproduce the record exactly
+template <typename Record>
+void CheckRoundTrip(const Record& record, const string& what) {
+    string text = record.ToString();
+    Record fromText;
+    Check(ParseRecordText(text, fromText) && fromText.ToString() == text, what + " (text)");
+
+    string binary;
+    AppendRecordBinary(record, binary);
+    const char* pos = binary.data();
+    Record fromBinary;
+    Check(ParseRecordBinary(pos, binary.data() + binary.size(), fromBinary)
+          && pos == binary.data() + binary.size() && fromBinary.ToString() == text, what + " (binary)");
+}
+
+void RunRoundTripChecks() {
+    const string awkward = "a,b\\c,\\,\r\n,";
+
+    TransactionHistory transaction("Transfer", " to (" + awkward + ") ", 1234567.891, "Tue Sep 26 11:16:49 2023", 1003003, -0.1);
+    CheckRoundTrip(transaction, "transaction with escaped text");
+    Check(TransactionHistory(transaction.ToString()).GetMessage() == " to (" + awkward + ") ", "transaction message survives escaping");
+    Check(transaction.ToString().find("\\,") != string::npos && transaction.ToString().find("\\\\") != string::npos,
+          "commas and backslashes are escaped");
+    Check(transaction.ToString().find('\n') == string::npos, "line breaks are escaped");
+    CheckRoundTrip(TransactionHistory("Deposit", "", 0.0, "", 0, 0.0), "transaction with empty fields");
+
+    CheckRoundTrip(Account("1003003,1e-05"), "account with a small balance");
+    Account account;
+    account.SetAccountID(-2147483647 - 1);
+    account.SetBalance(0.1 + 0.2);
+    CheckRoundTrip(account, "account with extreme values");
+
+    CheckRoundTrip(User("Sara\\, Jr.,O\\\\Neil,s@x.com,sara,Passw0rd!,1003003"), "user with escaped text");
+
+    for (auto& line : ReadFile("history.txt")) {
+        Check(TransactionHistory(line).ToString() == line, "history.txt row: " + line);
+    }
+    for (auto& line : ReadFile("accounts.txt")) {
+        Check(Account(line).ToString() == line, "accounts.txt row: " + line);
+    }
+    for (auto& line : ReadFile("users.txt")) {
+        Check(User(line).ToString() == line, "users.txt row: " + line);
+    }
+}
+
+template <typename Body>
+double NanosecondsPerRow(int rows, Body body) {
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < rows; i++) {
+        body();
+    }
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / rows;
+}
+
+int main() {
+    RunRoundTripChecks();
+
+    const string line = "1003003,Transfer,400.3, to (sara) ,200.58,Tue Sep 26 11:16:49 2023";
+    const int rows = 1000000;
+    size_t sink = 0;
+
+    double legacy = NanosecondsPerRow(rows, [&] {
+        LegacyTransactionHistory transaction(line);
+        sink += transaction.ToString().size();
+    });
+    double constructor = NanosecondsPerRow(rows, [&] {
+        TransactionHistory transaction(line);
+        sink += transaction.ToString().size();
+    });
+
+    TransactionHistory transaction;
+    string buffer;
+    double reused = NanosecondsPerRow(rows, [&] {
+        ParseRecordText(line, transaction);
+        buffer.clear();
+        AppendRecordText(transaction, buffer);
+        sink += buffer.size();
+    });
+
+    string binary;
+    AppendRecordBinary(transaction, binary);
+    double binaryRow = NanosecondsPerRow(rows, [&] {
+        const char* pos = binary.data();
+        ParseRecordBinary(pos, binary.data() + binary.size(), transaction);
+        buffer.clear();
+        AppendRecordBinary(transaction, buffer);
+        sink += buffer.size();
+    });
+
+    cout << "Parse + serialize one history row (" << rows << " rows):\n";
+    cout << "  legacy SplitString/ostringstream: " << legacy << " ns\n";
+    cout << "  schema constructor/ToString:      " << constructor << " ns\n";
+    cout << "  schema with reused buffers:       " << reused << " ns\n";
+    cout << "  schema binary:                    " << binaryRow << " ns\n";
+    cout << "(" << sink << " bytes)\n";
+
+    if (failures) {
+        cout << failures << " round-trip check(s) failed\n";
+        return 1;
+    }
+    cout << "All round-trip checks passed\n";
+    return 0;
+}
@@ -0,0 +1,118 @@
+// Commit latency while a long report reads the accounts.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -pthread benchmarks/SnapshotBenchmark.cpp -o SnapshotBenchmark && ./SnapshotBenchmark
+//
+// Runs transfers between random accounts, publishing the two changed accounts
+// after each one, and times every commit. This is repeated with no reader, with
+// one Snapshot held open for the whole run (a long report, which must not slow
+// commits down on any number of cores), with a reader scanning every account
+// through a Snapshot, and with a reader that holds one lock over the accounts
+// instead. Every scan must see the same total; the program exits with a
+// non-zero status if one doesn't. A scanning reader also competes with the
+// writer for the CPU unless it runs on a core of its own.
+
+#define main BankSystemMain
+#include "../BankSystem.cpp"
+#undef main
+
+#include <random>
+
+int main() {
+    const int accountCount = 20000;
+    const int rowsPerAccount = 20;
+    const int transfers = 20000;
+    const double total = accountCount * 1000.0;
+    cout << "Hardware threads: " << max(1u, thread::hardware_concurrency()) << "\n";
+
+    map<int, Account> accounts;
+    vector<int> allAccounts;
+    for (int id = 0; id < accountCount; id++) {
+        Account account(to_string(id) + ",1000");
+        for (int row = 0; row < rowsPerAccount; row++) {
+            account.AddTransaction(TransactionHistory("Deposit", "", 50, "Mon Sep 25 18:29:31 2023", id, 1000));
+        }
+        accounts[id] = account;
+        allAccounts.push_back(id);
+    }
+    SnapshotStore store;
+    store.Publish(accounts, allAccounts);
+
+    const char* names[] = { "no reader", "held snapshot", "snapshot reader", "locking reader" };
+    long long inconsistent = 0;
+    for (int mode = 0; mode < 4; mode++) {
+        atomic<bool> stop{false};
+        atomic<long long> scans{0}, badScans{0};
+        mutex accountsMutex;
+
+        unique_ptr<Snapshot> held(mode == 1 ? new Snapshot(store) : nullptr);
+        thread reader([&] {
+            while (mode >= 2 && !stop) {
+                double sum = 0.0;
+                size_t rows = 0;
+                if (mode == 2) {
+                    Snapshot snapshot(store);
+                    for (const AccountVersion* account : snapshot.Accounts()) {
+                        sum += account->balance;
+                        Snapshot::ForEachTransaction(*account, [&](const TransactionHistory&) { rows++; });
+                    }
+                } else {
+                    lock_guard<mutex> lock(accountsMutex);
+                    for (auto& accountPair : accounts) {
+                        sum += accountPair.second.GetBalance();
+                        rows += accountPair.second.GetTransactions().size();
+                    }
+                }
+                if (sum != total || rows == 0) {
+                    badScans++;
+                }
+                scans++;
+            }
+        });
+
+        vector<double> latencies;
+        mt19937 random(1);
+        for (int i = 0; i < transfers; i++) {
+            int from = random() % accountCount, to = random() % accountCount;
+            if (from == to) {
+                continue;
+            }
+            auto start = chrono::steady_clock::now();
+            {
+                unique_lock<mutex> lock(accountsMutex, defer_lock);
+                if (mode == 3) {
+                    lock.lock();
+                }
+                accounts[from].UpdateBalance(-1);
+                accounts[from].AddTransaction(TransactionHistory("Transfer", "", 1, "Mon Sep 25 18:29:31 2023", from, 0));
+                accounts[to].UpdateBalance(1);
+                accounts[to].AddTransaction(TransactionHistory("Receive", "", 1, "Mon Sep 25 18:29:31 2023", to, 0));
+            }
+            store.Publish(accounts, { from, to });
+            latencies.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+        }
+        stop = true;
+        reader.join();
+        if (held) {
+            double sum = 0.0;
+            for (const AccountVersion* account : held->Accounts()) {
+                sum += account->balance;
+            }
+            scans++;
+            badScans += sum != total;
+            held.reset();
+        }
+
+        sort(latencies.begin(), latencies.end());
+        printf("%-16s commit p50 %7.1f us  p99 %7.1f us  reader scans %lld  inconsistent %lld\n",
+               names[mode], latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100],
+               scans.load(), badScans.load());
+        inconsistent += badScans;
+    }
+
+    if (inconsistent) {
+        cout << "FAIL: " << inconsistent << " scan(s) saw a half-applied transfer\n";
+        return 1;
+    }
+    return 0;
+}